@@ -6,8 +6,11 @@
 #include "fmt/core.h"
 #include "move.hpp"
 #include "utils.hpp"
+#include "zobrist.hpp"
+#include <algorithm>
 #include <bit>
 #include <cassert>
+#include <cstdlib>
 #include <optional>
 #include <stdint.h>
 
@@ -50,7 +53,6 @@ Board::Board(std::vector<Piece> pieces, Color player_to_move,
     psqt.at(color) = psqt_side;
   }
 
-  std::stack<PosData> history;
   PosData pos_data = {
       .player_to_move = player_to_move,
       .castling_rights = castling_rights,
@@ -58,11 +60,13 @@ Board::Board(std::vector<Piece> pieces, Color player_to_move,
       .halfmove_clock = halfmove_clock,
       .fullmove_number = fullmove_number,
       .captured_piece = std::nullopt,
+      .moved_piece = std::nullopt,
       .material = material,
       .psqt = psqt,
+      .zobrist_key = 0,
   };
-  history.push(pos_data);
-  this->history = history;
+  pos_data.zobrist_key = calc_zobrist_key(pos_data);
+  this->history = {pos_data};
 
   std::stack<Move> moves;
   this->move_history = moves;
@@ -107,22 +111,103 @@ bool Board::piece_at_pos(int pos, Color color, PieceType piece_type) const {
   return ((piece_bbs.at(color).at(piece_type) >> pos) & (uint64_t)1) == 1;
 }
 
-Color Board::get_player_to_move() const { return history.top().player_to_move; }
+Color Board::get_player_to_move() const {
+  return history.back().player_to_move;
+}
 
-int Board::get_halfmove_clock() const { return history.top().halfmove_clock; }
-int Board::get_fullmove_number() const { return history.top().fullmove_number; }
+int Board::get_halfmove_clock() const { return history.back().halfmove_clock; }
+int Board::get_fullmove_number() const {
+  return history.back().fullmove_number;
+}
 std::optional<int> Board::get_en_passant_square() const {
-  return history.top().en_passant_square;
+  return history.back().en_passant_square;
 }
 std::optional<Piece> Board::get_captured_piece() const {
-  return history.top().captured_piece;
+  return history.back().captured_piece;
+}
+
+std::optional<Piece> Board::get_moved_piece(int plies_ago) const {
+  if (plies_ago < 1 || plies_ago >= (int)history.size()) {
+    return std::nullopt;
+  }
+  return history.at(history.size() - plies_ago).moved_piece;
 }
 
 int Board::get_material(Color color) const {
-  return history.top().material.at(color);
+  return history.back().material.at(color);
 }
 
-int Board::get_psqt(Color color) const { return history.top().psqt.at(color); }
+uint64_t Board::get_zobrist_key() const { return history.back().zobrist_key; }
+
+uint64_t Board::calc_zobrist_key(const PosData &pos_data) const {
+  const ZobristKeys &keys = get_zobrist_keys();
+  uint64_t key = 0;
+  for (int color = 0; color < 2; color++) {
+    for (int piece = 0; piece < 6; piece++) {
+      uint64_t piece_bb = piece_bbs.at(color).at(piece);
+      while (piece_bb) {
+        key ^= keys.pieces.at(color).at(piece).at(bits::pop_lsb(piece_bb));
+      }
+    }
+  }
+  if (pos_data.player_to_move == BLACK) {
+    key ^= keys.black_to_move;
+  }
+  key ^= zobrist_castling_key(pos_data.castling_rights);
+  if (pos_data.en_passant_square.has_value()) {
+    key ^= keys.en_passant.at(pos_data.en_passant_square.value() % 8);
+  }
+  return key;
+}
+
+uint64_t Board::updated_zobrist_key(const Move &move, PieceType piece_type,
+                                    std::optional<Piece> captured_piece,
+                                    const PosData &new_pos_data) const {
+  const ZobristKeys &keys = get_zobrist_keys();
+  const PosData &pos_data = history.back();
+  const Color player = pos_data.player_to_move;
+  const PieceType new_piece_type =
+      move.move_type == PROMOTION ? move.promotion_piece.value() : piece_type;
+
+  uint64_t key = pos_data.zobrist_key ^ keys.black_to_move;
+  key ^= keys.pieces.at(player).at(piece_type).at(move.start);
+  key ^= keys.pieces.at(player).at(new_piece_type).at(move.end);
+  if (captured_piece.has_value()) {
+    const Piece &p = captured_piece.value();
+    key ^= keys.pieces.at(p.color).at(p.piece_type).at(p.pos);
+  }
+  if (move.move_type == CASTLING) {
+    const int rook = get_castling_rook(move, player);
+    const int rook_new = move.end > move.start ? rook - 2 : rook + 3;
+    key ^= keys.pieces.at(player).at(ROOK).at(rook);
+    key ^= keys.pieces.at(player).at(ROOK).at(rook_new);
+  }
+
+  key ^= zobrist_castling_key(pos_data.castling_rights) ^
+         zobrist_castling_key(new_pos_data.castling_rights);
+  if (pos_data.en_passant_square.has_value()) {
+    key ^= keys.en_passant.at(pos_data.en_passant_square.value() % 8);
+  }
+  if (new_pos_data.en_passant_square.has_value()) {
+    key ^= keys.en_passant.at(new_pos_data.en_passant_square.value() % 8);
+  }
+  return key;
+}
+
+int Board::get_non_pawn_material(Color color) const {
+  const int pawns = std::popcount(piece_bbs.at(color).at(PAWN));
+  return get_material(color) - KING_VALUE - pawns * PAWN_VALUE;
+}
+
+// whether the color has pawns that can promote on their next move
+bool Board::has_pawns_about_to_promote(Color color) const {
+  const int rank = color == WHITE ? 1 : 6;
+  return piece_bbs.at(color).at(PAWN) & masks.ranks.at(rank);
+}
+
+int Board::get_psqt(Color color) const {
+  return history.back().psqt.at(color);
+}
 
 bool Board::is_lone_king(Color color) const {
   return std::popcount(side_bbs.at(color)) == 1;
@@ -175,13 +260,14 @@ std::array<Castling, 2> Board::updated_castling_rights(const Move &move) const {
 
   std::array<Castling, 2> castling_rights;
   castling_rights.at(get_player_to_move()) = {
-      .kingside =
-          disable_kingside_player
-              ? false
-              : history.top().castling_rights.at(get_player_to_move()).kingside,
+      .kingside = disable_kingside_player
+                      ? false
+                      : history.back()
+                            .castling_rights.at(get_player_to_move())
+                            .kingside,
       .queenside = disable_queenside_player
                        ? false
-                       : history.top()
+                       : history.back()
                              .castling_rights.at(get_player_to_move())
                              .queenside,
   };
@@ -192,10 +278,10 @@ std::array<Castling, 2> Board::updated_castling_rights(const Move &move) const {
   castling_rights.at(opponent) = {
       .kingside = disable_kingside_opponent
                       ? false
-                      : history.top().castling_rights.at(opponent).kingside,
+                      : history.back().castling_rights.at(opponent).kingside,
       .queenside = disable_queenside_opponent
                        ? false
-                       : history.top().castling_rights.at(opponent).queenside,
+                       : history.back().castling_rights.at(opponent).queenside,
   };
 
   return castling_rights;
@@ -304,8 +390,12 @@ void Board::make(const Move &move) {
 
   const std::optional<Piece> captured_piece_opt =
       get_piece_to_be_captured(move);
+  const PieceType new_piece_type =
+      move.move_type == PROMOTION && move.promotion_piece.has_value()
+          ? move.promotion_piece.value()
+          : piece_type;
 
-  const PosData new_pos_data = {
+  PosData new_pos_data = {
       .player_to_move = get_opponent(player_to_move),
       .castling_rights = updated_castling_rights(move),
       .en_passant_square = move.move_type == PAWN_TWO_SQUARES_FORWARD
@@ -313,21 +403,21 @@ void Board::make(const Move &move) {
                                : std::nullopt,
       .halfmove_clock = piece_type == PAWN || captured_piece_opt.has_value()
                             ? 0
-                            : history.top().halfmove_clock + 1,
+                            : history.back().halfmove_clock + 1,
       .fullmove_number =
-          history.top().fullmove_number + (player_to_move == BLACK ? 1 : 0),
+          history.back().fullmove_number + (player_to_move == BLACK ? 1 : 0),
       .captured_piece = captured_piece_opt,
+      .moved_piece = Piece(new_piece_type, player_to_move, move.end),
       .material = updated_material(move, captured_piece_opt),
       .psqt = updated_psqt(move, captured_piece_opt),
+      .zobrist_key = 0,
   };
+  new_pos_data.zobrist_key =
+      updated_zobrist_key(move, piece_type, captured_piece_opt, new_pos_data);
 
-  history.push(new_pos_data);
+  history.push_back(new_pos_data);
   move_history.push(move);
 
-  const PieceType new_piece_type =
-      move.move_type == PROMOTION && move.promotion_piece.has_value()
-          ? move.promotion_piece.value()
-          : piece_type;
   remove_piece(move.start, piece_type, player_to_move);
   add_piece(move.end, new_piece_type, player_to_move);
 
@@ -373,16 +463,46 @@ void Board::undo() {
     add_piece(rook, ROOK, move_played_by);
   }
 
-  const std::optional<Piece> captured_piece_opt = history.top().captured_piece;
+  const std::optional<Piece> captured_piece_opt = history.back().captured_piece;
   if (captured_piece_opt.has_value()) {
     const Piece p = captured_piece_opt.value();
     remove_piece(p.pos, p.piece_type, p.color);
   }
 
-  history.pop();
+  history.pop_back();
   move_history.pop();
 }
 
+// pass the turn to the opponent without moving a piece
+void Board::make_null_move() {
+  const PosData &pos_data = history.back();
+  const PosData new_pos_data = {
+      .player_to_move = get_opponent(pos_data.player_to_move),
+      .castling_rights = pos_data.castling_rights,
+      .en_passant_square = std::nullopt,
+      // a position can't repeat one from before the null move,
+      // so treat it like an irreversible move
+      .halfmove_clock = 0,
+      .fullmove_number =
+          pos_data.fullmove_number + (pos_data.player_to_move == BLACK ? 1 : 0),
+      .captured_piece = std::nullopt,
+      .moved_piece = std::nullopt,
+      .material = pos_data.material,
+      .psqt = pos_data.psqt,
+      .zobrist_key = pos_data.zobrist_key ^ get_zobrist_keys().black_to_move ^
+                     (pos_data.en_passant_square.has_value()
+                          ? get_zobrist_keys().en_passant.at(
+                                pos_data.en_passant_square.value() % 8)
+                          : 0),
+  };
+  history.push_back(new_pos_data);
+}
+
+void Board::undo_null_move() {
+  assert(!history.back().moved_piece.has_value());
+  history.pop_back();
+}
+
 void Board::add_piece(int pos, PieceType piece_type, Color color) {
   piece_bbs.at(color).at(piece_type) |= masks.squares.at(pos);
   side_bbs.at(color) |= masks.squares.at(pos);
@@ -411,19 +531,22 @@ bool Board::is_insufficient_material() const {
 }
 
 bool Board::is_draw_by_fifty_move_rule() const {
-  return history.top().halfmove_clock > 100;
+  return history.back().halfmove_clock > 100;
 }
 
+// The positions since the last capture or pawn move are compared by their
+// zobrist keys. Only the positions with the same player to move can be equal.
 bool Board::is_threefold_repetition() const {
-  if (history.top().halfmove_clock < 5) {
+  const PosData &pos_data = history.back();
+  if (pos_data.halfmove_clock < 5) {
     return false;
   }
 
-  Board b = *this;
+  const int first = std::max((int)history.size() - 1 - pos_data.halfmove_clock,
+                             0);
   int repetitions = 0;
-  while (!(b.move_history.empty() || history.top().halfmove_clock == 0)) {
-    b.undo();
-    if (*this == b) {
+  for (int i = history.size() - 3; i >= first; i -= 2) {
+    if (history.at(i).zobrist_key == pos_data.zobrist_key) {
       repetitions++;
       if (repetitions == 2) {
         return true;
@@ -433,6 +556,78 @@ bool Board::is_threefold_repetition() const {
   return false;
 }
 
+// The draw rule of the search: repeating a position from after the root is
+// scored as a draw, as the player who could repeat it once can repeat it
+// again. Positions from before the root have to occur three times.
+bool Board::is_repetition(int ply_from_root) const {
+  const PosData &pos_data = history.back();
+  if (pos_data.halfmove_clock < 4) {
+    return false;
+  }
+
+  const int first = std::max((int)history.size() - 1 - pos_data.halfmove_clock,
+                             0);
+  int repetitions = 0;
+  for (int i = history.size() - 3; i >= first; i -= 2) {
+    if (history.at(i).zobrist_key == pos_data.zobrist_key) {
+      const int plies_ago = history.size() - 1 - i;
+      repetitions++;
+      if (plies_ago < ply_from_root || repetitions == 2) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static uint64_t squares_between(int pos1, int pos2) {
+  const int rank_diff = (pos2 >> 3) - (pos1 >> 3);
+  const int file_diff = (pos2 & 7) - (pos1 & 7);
+  // not on a line, as for a knight move
+  if (rank_diff != 0 && file_diff != 0 &&
+      std::abs(rank_diff) != std::abs(file_diff)) {
+    return 0;
+  }
+
+  const int distance = std::max(std::abs(rank_diff), std::abs(file_diff));
+  const int step = (rank_diff * 8 + file_diff) / distance;
+  uint64_t between = 0;
+  for (int pos = pos1 + step; pos != pos2; pos += step) {
+    between |= 1ULL << pos;
+  }
+  return between;
+}
+
+// Whether the player to move has a move that repeats a position from
+// earlier in the search, without having to search the move. Such a move
+// is found by looking up the difference between the zobrist keys of the
+// current and the earlier position in the cuckoo table (Marcel van
+// Kervinck's algorithm). Positions before the root are not considered,
+// as repeating them once isn't a draw by is_repetition.
+bool Board::has_upcoming_repetition(int ply_from_root) const {
+  const PosData &pos_data = history.back();
+  const int end = std::min({pos_data.halfmove_clock, ply_from_root - 1,
+                            (int)history.size() - 1});
+  const uint64_t occupied = side_bbs.at(WHITE) | side_bbs.at(BLACK);
+  for (int plies_ago = 3; plies_ago <= end; plies_ago += 2) {
+    const uint64_t move_key =
+        pos_data.zobrist_key ^
+        history.at(history.size() - 1 - plies_ago).zobrist_key;
+    const std::optional<Move> move = cuckoo_lookup(move_key);
+    if (!move.has_value() ||
+        (squares_between(move->start, move->end) & occupied)) {
+      continue;
+    }
+    // the piece to move back has to belong to the player to move
+    const int piece_pos =
+        (occupied & (1ULL << move->start)) ? move->start : move->end;
+    if (side_bbs.at(pos_data.player_to_move) & (1ULL << piece_pos)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 int Board::get_doubled_pawns(Color color) const {
   uint64_t pawn_bb = piece_bbs.at(color).at(PieceType::PAWN);
   int doubled_pawns = 0;
@@ -18,8 +18,12 @@ struct PosData {
   int halfmove_clock;
   int fullmove_number;
   std::optional<Piece> captured_piece;
+  // the piece that made the move leading to this position,
+  // on the square it moved to
+  std::optional<Piece> moved_piece;
   std::array<int, 2> material;
   std::array<int, 2> psqt;
+  uint64_t zobrist_key;
 };
 
 const int NR_PIECES = 6;
@@ -41,7 +45,11 @@ public:
   int get_fullmove_number() const;
   std::optional<int> get_en_passant_square() const;
   std::optional<Piece> get_captured_piece() const;
+  std::optional<Piece> get_moved_piece(int plies_ago) const;
+  uint64_t get_zobrist_key() const;
   int get_material(Color color) const;
+  int get_non_pawn_material(Color color) const;
+  bool has_pawns_about_to_promote(Color color) const;
   int get_psqt(Color color) const;
   int get_doubled_pawns(Color color) const;
 
@@ -51,8 +59,11 @@ public:
 
   void make(const Move &move);
   void undo();
+  void make_null_move();
+  void undo_null_move();
 
   bool is_in_check(Color color) const;
+  bool see(const Move &move, int threshold) const;
 
   std::vector<Move> get_legal_moves();
   std::vector<Move> get_forcing_moves(const std::vector<Move> &legal_moves);
@@ -60,11 +71,13 @@ public:
   bool is_insufficient_material() const;
   bool is_draw_by_fifty_move_rule() const;
   bool is_threefold_repetition() const;
+  bool is_repetition(int ply_from_root) const;
+  bool has_upcoming_repetition(int ply_from_root) const;
 
 private:
   std::array<std::array<uint64_t, 6>, 2> piece_bbs;
   std::array<uint64_t, 2> side_bbs;
-  std::stack<PosData> history;
+  std::vector<PosData> history;
   std::stack<Move> move_history;
   const Masks masks;
 
@@ -76,6 +89,10 @@ private:
   updated_material(const Move &move, std::optional<Piece> captured_piece) const;
   std::array<int, 2> updated_psqt(const Move &move,
                                   std::optional<Piece> captured_piece) const;
+  uint64_t calc_zobrist_key(const PosData &pos_data) const;
+  uint64_t updated_zobrist_key(const Move &move, PieceType piece_type,
+                               std::optional<Piece> captured_piece,
+                               const PosData &new_pos_data) const;
 
   std::optional<PieceType> piece_type(int pos, Color color) const;
   std::array<Castling, 2> updated_castling_rights(const Move &move) const;
@@ -97,12 +114,16 @@ private:
   uint64_t gen_rook_attacks(int start) const;
   uint64_t gen_bishop_attacks(int start) const;
   uint64_t gen_queen_attacks(int start) const;
+  uint64_t gen_rook_attacks(int start, uint64_t occupied) const;
+  uint64_t gen_bishop_attacks(int start, uint64_t occupied) const;
 
-  uint64_t gen_rank_attacks(int start) const;
-  uint64_t gen_diag_attacks(int start, uint64_t diagonal_mask) const;
+  uint64_t gen_rank_attacks(int start, uint64_t occupied) const;
+  uint64_t gen_diag_attacks(int start, uint64_t diagonal_mask,
+                            uint64_t occupied) const;
 
   uint64_t get_attacking_bb(Color color) const;
   bool is_attacking(int pos, Color color) const;
+  uint64_t get_attackers_bb(int pos, uint64_t occupied) const;
 
   bool is_lone_king(Color color) const;
   bool is_endgame() const;
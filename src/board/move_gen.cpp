@@ -30,7 +30,7 @@ uint64_t Board::gen_castling_moves_bb(int start) const {
     return 0;
   }
 
-  Castling castling_rights = history.top().castling_rights.at(player);
+  Castling castling_rights = history.back().castling_rights.at(player);
   uint64_t attacked_bb = get_attacking_bb(get_opponent(player));
   if (attacked_bb & masks.squares.at(start)) {
     return 0;
@@ -151,8 +151,7 @@ void Board::gen_pawn_moves(int start, std::vector<Move> &moves) const {
 
 // https://www.chessprogramming.org/Efficient_Generation_of_Sliding_Piece_Attacks#Sliding_Attacks_by_Calculation
 // TODO: find a way to not use bits::reverse
-uint64_t Board::gen_rank_attacks(int start) const {
-  uint64_t o = side_bbs[WHITE] | side_bbs[BLACK];
+uint64_t Board::gen_rank_attacks(int start, uint64_t o) const {
   uint64_t s = masks.squares[start];
   uint64_t o_rev = bits::reverse(o);
   uint64_t s_rev = bits::reverse(s);
@@ -160,11 +159,11 @@ uint64_t Board::gen_rank_attacks(int start) const {
          masks.ranks[start >> 3];
 }
 
-uint64_t Board::gen_diag_attacks(int start, uint64_t diagonal_mask) const {
+uint64_t Board::gen_diag_attacks(int start, uint64_t diagonal_mask,
+                                 uint64_t occ) const {
   uint64_t slider = masks.squares[start];     // single bit 1 << sq, 2^sq
   uint64_t lineMask = diagonal_mask ^ slider; // excludes square of slider
 
-  uint64_t occ = side_bbs[WHITE] | side_bbs[BLACK];
   uint64_t forward =
       occ &
       lineMask; // also performs the first subtraction by clearing the s in o
@@ -175,16 +174,25 @@ uint64_t Board::gen_diag_attacks(int start, uint64_t diagonal_mask) const {
   return forward & lineMask;
 }
 
-uint64_t Board::gen_rook_attacks(int start) const {
-  return gen_diag_attacks(start, masks.files.at(start % 8)) |
-         gen_rank_attacks(start);
+uint64_t Board::gen_rook_attacks(int start, uint64_t occupied) const {
+  return gen_diag_attacks(start, masks.files.at(start % 8), occupied) |
+         gen_rank_attacks(start, occupied);
 }
 
-uint64_t Board::gen_bishop_attacks(int start) const {
+uint64_t Board::gen_bishop_attacks(int start, uint64_t occupied) const {
   int file = start % 8;
   int rank = start >> 3;
-  return gen_diag_attacks(start, masks.diags.at(file + rank)) |
-         gen_diag_attacks(start, masks.antidiags.at(file - rank + 7));
+  return gen_diag_attacks(start, masks.diags.at(file + rank), occupied) |
+         gen_diag_attacks(start, masks.antidiags.at(file - rank + 7),
+                          occupied);
+}
+
+uint64_t Board::gen_rook_attacks(int start) const {
+  return gen_rook_attacks(start, side_bbs[WHITE] | side_bbs[BLACK]);
+}
+
+uint64_t Board::gen_bishop_attacks(int start) const {
+  return gen_bishop_attacks(start, side_bbs[WHITE] | side_bbs[BLACK]);
 }
 
 uint64_t Board::gen_queen_attacks(int start) const {
@@ -324,6 +332,31 @@ bool Board::is_attacking(int pos, Color color) const {
   return false;
 }
 
+// all pieces of both colors attacking the square,
+// given which squares are occupied
+uint64_t Board::get_attackers_bb(int pos, uint64_t occupied) const {
+  const uint64_t bishops = piece_bbs.at(WHITE).at(BISHOP) |
+                           piece_bbs.at(BLACK).at(BISHOP) |
+                           piece_bbs.at(WHITE).at(QUEEN) |
+                           piece_bbs.at(BLACK).at(QUEEN);
+  const uint64_t rooks =
+      piece_bbs.at(WHITE).at(ROOK) | piece_bbs.at(BLACK).at(ROOK) |
+      piece_bbs.at(WHITE).at(QUEEN) | piece_bbs.at(BLACK).at(QUEEN);
+  const uint64_t knights =
+      piece_bbs.at(WHITE).at(KNIGHT) | piece_bbs.at(BLACK).at(KNIGHT);
+  const uint64_t kings =
+      piece_bbs.at(WHITE).at(KING) | piece_bbs.at(BLACK).at(KING);
+
+  return (masks.pawn_captures.at(BLACK).at(pos) &
+          piece_bbs.at(WHITE).at(PAWN)) |
+         (masks.pawn_captures.at(WHITE).at(pos) &
+          piece_bbs.at(BLACK).at(PAWN)) |
+         (masks.knight_moves.at(pos) & knights) |
+         (masks.king_moves.at(pos) & kings) |
+         (gen_bishop_attacks(pos, occupied) & bishops) |
+         (gen_rook_attacks(pos, occupied) & rooks);
+}
+
 bool Board::is_in_check(Color color) const {
   uint64_t king_bb = piece_bbs.at(color).at(KING);
   assert(king_bb);
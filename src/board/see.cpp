@@ -0,0 +1,101 @@
+#include "board.hpp"
+#include "board/bits.hpp"
+#include "defs.hpp"
+#include "evaluation/evaluation.hpp"
+#include "move.hpp"
+#include "utils.hpp"
+#include <cassert>
+#include <optional>
+
+// Static exchange evaluation:
+// whether the material balance after all captures and recaptures on the end
+// square of the move is at least the threshold, assuming both sides always
+// recapture with their least valuable piece and may stop capturing at any time.
+//
+// Pieces that are revealed as the attackers in front of them are removed
+// (x-rays) are included, but pins are not taken into account.
+bool Board::see(const Move &move, int threshold) const {
+  if (move.move_type == CASTLING) {
+    return threshold <= 0;
+  }
+
+  const Color player = get_player_to_move();
+  const std::optional<PieceType> moving_piece = piece_type(move.start, player);
+  assert(moving_piece.has_value());
+  const std::optional<Piece> captured_piece = get_piece_to_be_captured(move);
+
+  // the value of the exchange so far, minus the threshold, from the
+  // perspective of the side that made the last capture
+  int swap = (captured_piece.has_value()
+                  ? PIECE_VALUES.at(captured_piece.value().piece_type)
+                  : 0) -
+             threshold;
+  PieceType piece_on_square = moving_piece.value();
+  if (move.move_type == PROMOTION) {
+    swap += PIECE_VALUES.at(move.promotion_piece.value()) - PAWN_VALUE;
+    piece_on_square = move.promotion_piece.value();
+  }
+  if (swap < 0) {
+    return false;
+  }
+
+  // even losing the piece for nothing still meets the threshold
+  swap = PIECE_VALUES.at(piece_on_square) - swap;
+  if (swap <= 0) {
+    return true;
+  }
+
+  uint64_t occupied = (side_bbs.at(WHITE) | side_bbs.at(BLACK)) ^
+                      masks.squares.at(move.start);
+  if (captured_piece.has_value()) {
+    occupied &= ~masks.squares.at(captured_piece.value().pos);
+  }
+  occupied |= masks.squares.at(move.end);
+
+  const uint64_t diagonal_sliders =
+      piece_bbs.at(WHITE).at(BISHOP) | piece_bbs.at(BLACK).at(BISHOP) |
+      piece_bbs.at(WHITE).at(QUEEN) | piece_bbs.at(BLACK).at(QUEEN);
+  const uint64_t straight_sliders =
+      piece_bbs.at(WHITE).at(ROOK) | piece_bbs.at(BLACK).at(ROOK) |
+      piece_bbs.at(WHITE).at(QUEEN) | piece_bbs.at(BLACK).at(QUEEN);
+
+  uint64_t attackers = get_attackers_bb(move.end, occupied);
+  Color side = player;
+  bool result = true;
+  while (true) {
+    side = get_opponent(side);
+    attackers &= occupied;
+    const uint64_t side_attackers = attackers & side_bbs.at(side);
+    if (!side_attackers) {
+      break;
+    }
+
+    PieceType attacker = PAWN;
+    while (!(side_attackers & piece_bbs.at(side).at(attacker))) {
+      attacker = (PieceType)(attacker + 1);
+    }
+
+    // capturing with the king is only possible if the square is not defended
+    if (attacker == KING) {
+      return attackers & side_bbs.at(get_opponent(side)) ? result : !result;
+    }
+
+    result = !result;
+    swap = PIECE_VALUES.at(attacker) - swap;
+    if (swap < result) {
+      break;
+    }
+
+    uint64_t attacker_bb = side_attackers & piece_bbs.at(side).at(attacker);
+    occupied ^= masks.squares.at(bits::pop_lsb(attacker_bb));
+
+    // the capture might reveal a slider behind the attacker
+    if (attacker == PAWN || attacker == BISHOP || attacker == QUEEN) {
+      attackers |= gen_bishop_attacks(move.end, occupied) & diagonal_sliders;
+    }
+    if (attacker == ROOK || attacker == QUEEN) {
+      attackers |= gen_rook_attacks(move.end, occupied) & straight_sliders;
+    }
+  }
+  return result;
+}
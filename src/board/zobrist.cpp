@@ -0,0 +1,123 @@
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <utility>
+
+static ZobristKeys create_zobrist_keys() {
+  // a fixed seed gives the same keys every run
+  std::mt19937_64 random(20240101);
+  ZobristKeys keys;
+  for (auto &color_keys : keys.pieces) {
+    for (auto &piece_keys : color_keys) {
+      for (uint64_t &key : piece_keys) {
+        key = random();
+      }
+    }
+  }
+  keys.black_to_move = random();
+  for (auto &color_keys : keys.castling) {
+    for (uint64_t &key : color_keys) {
+      key = random();
+    }
+  }
+  for (uint64_t &key : keys.en_passant) {
+    key = random();
+  }
+  return keys;
+}
+
+const ZobristKeys &get_zobrist_keys() {
+  static const ZobristKeys keys = create_zobrist_keys();
+  return keys;
+}
+
+uint64_t zobrist_castling_key(const std::array<Castling, 2> &castling_rights) {
+  const ZobristKeys &keys = get_zobrist_keys();
+  uint64_t key = 0;
+  for (int color = 0; color < 2; color++) {
+    if (castling_rights.at(color).kingside) {
+      key ^= keys.castling.at(color).at(0);
+    }
+    if (castling_rights.at(color).queenside) {
+      key ^= keys.castling.at(color).at(1);
+    }
+  }
+  return key;
+}
+
+static int cuckoo_hash_1(uint64_t key) { return key % CUCKOO_TABLE_SIZE; }
+
+static int cuckoo_hash_2(uint64_t key) {
+  return (key >> 16) % CUCKOO_TABLE_SIZE;
+}
+
+// whether the piece can move between the squares on an empty board
+static bool can_move_between(PieceType piece_type, int pos1, int pos2) {
+  const int rank_distance = std::abs((pos1 >> 3) - (pos2 >> 3));
+  const int file_distance = std::abs((pos1 & 7) - (pos2 & 7));
+  const bool straight = rank_distance == 0 || file_distance == 0;
+  const bool diagonal = rank_distance == file_distance;
+  switch (piece_type) {
+  case KNIGHT:
+    return rank_distance * file_distance == 2;
+  case BISHOP:
+    return diagonal;
+  case ROOK:
+    return straight;
+  case QUEEN:
+    return straight || diagonal;
+  case KING:
+    return std::max(rank_distance, file_distance) == 1;
+  default:
+    return false;
+  }
+}
+
+static CuckooTable create_cuckoo_table() {
+  const ZobristKeys &zobrist_keys = get_zobrist_keys();
+  CuckooTable table = {};
+  for (int color = 0; color < 2; color++) {
+    for (PieceType piece_type : {KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+      for (int pos1 = 0; pos1 < 64; pos1++) {
+        for (int pos2 = pos1 + 1; pos2 < 64; pos2++) {
+          if (!can_move_between(piece_type, pos1, pos2)) {
+            continue;
+          }
+          const auto &piece_keys = zobrist_keys.pieces.at(color).at(piece_type);
+          uint64_t key = piece_keys.at(pos1) ^ piece_keys.at(pos2) ^
+                         zobrist_keys.black_to_move;
+          std::optional<Move> move = Move(pos1, pos2);
+          // insert the move, moving any move in its way to its other slot
+          int slot = cuckoo_hash_1(key);
+          while (true) {
+            std::swap(table.keys.at(slot), key);
+            std::swap(table.moves.at(slot), move);
+            if (!move.has_value()) {
+              break;
+            }
+            slot = slot == cuckoo_hash_1(key) ? cuckoo_hash_2(key)
+                                              : cuckoo_hash_1(key);
+          }
+        }
+      }
+    }
+  }
+  return table;
+}
+
+const CuckooTable &get_cuckoo_table() {
+  static const CuckooTable table = create_cuckoo_table();
+  return table;
+}
+
+std::optional<Move> cuckoo_lookup(uint64_t move_key) {
+  const CuckooTable &table = get_cuckoo_table();
+  for (int slot : {cuckoo_hash_1(move_key), cuckoo_hash_2(move_key)}) {
+    if (table.keys.at(slot) == move_key) {
+      return table.moves.at(slot);
+    }
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+
+#include "defs.hpp"
+#include "move.hpp"
+
+// random keys that are xor:ed together to identify a position
+struct ZobristKeys {
+  // indexed by [color][piece type][square]
+  std::array<std::array<std::array<uint64_t, 64>, 6>, 2> pieces;
+  uint64_t black_to_move;
+  // indexed by [color][0 for kingside, 1 for queenside]
+  std::array<std::array<uint64_t, 2>, 2> castling;
+  // indexed by file
+  std::array<uint64_t, 8> en_passant;
+};
+
+const ZobristKeys &get_zobrist_keys();
+
+uint64_t zobrist_castling_key(const std::array<Castling, 2> &castling_rights);
+
+const int CUCKOO_TABLE_SIZE = 8192;
+
+// Every move of a non-pawn piece between two squares on an empty board,
+// indexed by how it changes the zobrist key. Such a move can be undone,
+// so it could repeat a position. Cuckoo hashing gives every move a slot in
+// one of two places, so a lookup is two probes.
+struct CuckooTable {
+  std::array<uint64_t, CUCKOO_TABLE_SIZE> keys;
+  std::array<std::optional<Move>, CUCKOO_TABLE_SIZE> moves;
+};
+
+const CuckooTable &get_cuckoo_table();
+
+// the move, in either direction, that changes the zobrist key by move_key
+std::optional<Move> cuckoo_lookup(uint64_t move_key);
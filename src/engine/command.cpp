@@ -10,6 +10,11 @@ Command::Command(CommandType type, int arg) {
   this->arg.integer = arg;
 }
 
+Command::Command(CommandType type, long arg) {
+  this->type = type;
+  this->arg.nodes = arg;
+}
+
 Command::Command(CommandType type, char *arg) {
   this->type = type;
   this->arg.str = arg;
@@ -24,10 +29,17 @@ Command::Command(CommandType type, Position position) {
   this->type = type;
   this->arg.position = position;
 }
+
+Command::Command(CommandType type, Option option) {
+  this->type = type;
+  this->arg.option = option;
+}
 Command Command::uci() { return Command(CommandType::UCI); }
 
 Command Command::is_ready() { return Command(CommandType::IsReady); }
 
+Command Command::new_game() { return Command(CommandType::NewGame); }
+
 Command Command::quit() { return Command(CommandType::Quit); }
 
 static char *str_to_c_str(const std::string_view str) {
@@ -70,6 +82,10 @@ Command Command::go_perft(int depth) {
   return Command(CommandType::GoPerft, depth);
 }
 
+Command Command::go_nodes(long nodes) {
+  return Command(CommandType::GoNodes, nodes);
+}
+
 Command Command::update_board(const std::string &fen,
                               const std::vector<std::string> moves) {
   size_t moves_size = moves.size();
@@ -85,3 +101,11 @@ Command Command::update_board(const std::string &fen,
   };
   return Command(CommandType::UpdateBoard, position);
 }
+
+Command Command::set_option(const std::string &name, const std::string &value) {
+  Option option = {
+      .name = str_to_c_str(name),
+      .value = str_to_c_str(value),
+  };
+  return Command(CommandType::SetOption, option);
+}
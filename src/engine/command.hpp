@@ -6,6 +6,7 @@
 enum CommandType {
   UCI,
   IsReady,
+  NewGame,
   Quit,
   Invalid,
   GoInfinite,
@@ -13,7 +14,9 @@ enum CommandType {
   GoMoveTime,
   GoGameTime,
   GoPerft,
+  GoNodes,
   UpdateBoard,
+  SetOption,
 };
 
 struct GameTime {
@@ -30,22 +33,35 @@ struct Position {
   size_t moves_size;
 };
 
+struct Option {
+  char *name;
+  char *value;
+};
+
 union CommandArg {
   int integer;
+  // go nodes, which can be more than fits an int
+  long nodes;
   char *str;
   GameTime game_time;
   Position position;
+  Option option;
 };
 
 class Command {
 public:
   CommandType type;
   union CommandArg arg;
+  // go ponder
+  bool ponder = false;
+  // go searchmoves, in uci notation
+  std::vector<std::string> search_moves = {};
 
   Command();
 
   static Command uci();
   static Command is_ready();
+  static Command new_game();
   static Command quit();
   static Command invalid(std::string_view str);
   static Command go_infinite();
@@ -54,13 +70,17 @@ public:
   static Command go_game_time(int white_time, int black_time, int white_inc,
                               int black_inc, int moves_to_go);
   static Command go_perft(int depth);
+  static Command go_nodes(long nodes);
   static Command update_board(const std::string &fen,
                               const std::vector<std::string> moves);
+  static Command set_option(const std::string &name, const std::string &value);
 
 private:
   Command(CommandType type);
   Command(CommandType type, int arg);
+  Command(CommandType type, long arg);
   Command(CommandType type, char *arg);
   Command(CommandType type, GameTime game_time);
   Command(CommandType type, Position position);
+  Command(CommandType type, Option option);
 };
@@ -1,11 +1,14 @@
 #include "engine.hpp"
 #include "board/board.hpp"
 #include "engine/command.hpp"
+#include "engine/mcts.hpp"
 #include "engine/search.hpp"
 #include "engine/time_management.hpp"
 #include "fen.hpp"
 #include "fmt/core.h"
 #include "perft.hpp"
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <ostream>
 #include <stdexcept>
@@ -25,17 +28,82 @@ void make_move(const char *move_uci, Board &board) {
       fmt::format("Illegal move: {} is not a legal move\n", move_uci));
 }
 
+// The legal moves among the moves given with go searchmoves.
+// No moves means all legal moves are searched.
+static std::vector<Move> get_search_moves(const Command &command,
+                                          Board &board) {
+  std::vector<Move> search_moves;
+  for (const Move &move : board.get_legal_moves()) {
+    if (std::find(command.search_moves.begin(), command.search_moves.end(),
+                  move.to_uci_notation()) != command.search_moves.end()) {
+      search_moves.push_back(move);
+    }
+  }
+  return search_moves;
+}
+
+// The memory of the Monte-Carlo tree search is only kept while it is the
+// search algorithm, and it has to be reallocated when the number of threads
+// changes
+static void
+update_mcts_memory(const Options &options,
+                   std::unique_ptr<mcts::SearchMemory> &mcts_memory) {
+  if (options.search_algorithm != MCTS) {
+    mcts_memory.reset();
+  } else if (!mcts_memory ||
+             mcts_memory->tables.size() != options.mcts_threads) {
+    // free the old memory before allocating the new
+    mcts_memory.reset();
+    mcts_memory = std::make_unique<mcts::SearchMemory>(options.mcts_threads);
+  }
+}
+
+static void run_search(Board &board, History &history,
+                       TranspositionTable &tt, const SearchLimits &limits,
+                       const Options &options,
+                       std::unique_ptr<mcts::SearchMemory> &mcts_memory,
+                       std::atomic<bool> &stop, std::atomic<bool> &ponder) {
+  switch (options.search_algorithm) {
+  case ALPHA_BETA: {
+    search::iterative_deepening_search(board, history, tt, limits, stop,
+                                       ponder);
+    break;
+  }
+  case MCTS: {
+    assert(mcts_memory);
+    mcts::search(board, history, limits, *mcts_memory, stop, ponder);
+    break;
+  }
+  }
+}
+
 void execute_command(const Command &command, std::atomic<bool> &stop,
-                     Board &board) {
+                     std::atomic<bool> &ponder, Board &board, History &history,
+                     TranspositionTable &tt, Options &options,
+                     std::unique_ptr<mcts::SearchMemory> &mcts_memory) {
   switch (command.type) {
   case UCI: {
-    fmt::println("id name {} {}\nid author {}\nuciok\n", NAME, VERSION, AUTHOR);
+    fmt::println("id name {} {}\nid author {}", NAME, VERSION, AUTHOR);
+    fmt::println("option name MultiPV type spin default 1 min 1 max {}",
+                 MAX_MULTI_PV);
+    fmt::println("option name SearchAlgorithm type combo default AlphaBeta "
+                 "var AlphaBeta var MCTS");
+    fmt::println("option name MCTSThreads type spin default 1 min 1 max {}",
+                 MCTS_MAX_THREADS);
+    fmt::println("uciok\n");
     break;
   }
   case IsReady: {
     fmt::println("readyok\n");
     break;
   }
+  case NewGame: {
+    // forget what was learned in earlier games so that searches in the new
+    // game don't depend on them
+    tt.clear();
+    history = History{};
+    break;
+  }
   case Invalid: {
     fmt::println("invalid input: '{}'", command.arg.str);
     free(command.arg.str);
@@ -63,26 +131,93 @@ void execute_command(const Command &command, std::atomic<bool> &stop,
     break;
   }
   case GoInfinite: {
-    search::iterative_deepening_search(board, MAX_DEPTH, MAX_TIME, stop);
+    const SearchLimits limits = {
+        .depth = MAX_DEPTH,
+        .allocated_time = MAX_TIME,
+        .multi_pv = options.multi_pv,
+        .search_moves = get_search_moves(command, board),
+    };
+    run_search(board, history, tt, limits, options, mcts_memory, stop,
+               ponder);
     break;
   }
   case GoDepth: {
-    search::iterative_deepening_search(board, command.arg.integer, MAX_TIME,
-                                       stop);
+    const SearchLimits limits = {
+        .depth = std::min(command.arg.integer, MAX_DEPTH),
+        .allocated_time = MAX_TIME,
+        .multi_pv = options.multi_pv,
+        .search_moves = get_search_moves(command, board),
+    };
+    run_search(board, history, tt, limits, options, mcts_memory, stop,
+               ponder);
     break;
   }
   case GoGameTime: {
     const int allocated_time = calc_allocated_time(board.get_player_to_move(),
                                                    command.arg.game_time.wtime,
                                                    command.arg.game_time.btime);
-    search::iterative_deepening_search(board, MAX_DEPTH, allocated_time, stop);
+    const SearchLimits limits = {
+        .depth = MAX_DEPTH,
+        .allocated_time = allocated_time,
+        .multi_pv = options.multi_pv,
+        .search_moves = get_search_moves(command, board),
+        .flexible_time = true,
+    };
+    run_search(board, history, tt, limits, options, mcts_memory, stop,
+               ponder);
     break;
   }
   case GoMoveTime: {
     // ensure a move is returned before the allocated time runs out
     int move_overhead = 50;
-    search::iterative_deepening_search(
-        board, MAX_DEPTH, command.arg.integer - move_overhead, stop);
+    const SearchLimits limits = {
+        .depth = MAX_DEPTH,
+        .allocated_time = command.arg.integer - move_overhead,
+        .multi_pv = options.multi_pv,
+        .search_moves = get_search_moves(command, board),
+    };
+    run_search(board, history, tt, limits, options, mcts_memory, stop,
+               ponder);
+    break;
+  }
+  case GoNodes: {
+    const SearchLimits limits = {
+        .depth = MAX_DEPTH,
+        .allocated_time = MAX_TIME,
+        .multi_pv = options.multi_pv,
+        .search_moves = get_search_moves(command, board),
+        .max_nodes = command.arg.nodes,
+    };
+    run_search(board, history, tt, limits, options, mcts_memory, stop,
+               ponder);
+    break;
+  }
+  case SetOption: {
+    const std::string name = command.arg.option.name;
+    const std::string value = command.arg.option.value;
+    try {
+      if (name == "MultiPV") {
+        options.multi_pv = std::clamp(std::stoi(value), 1, MAX_MULTI_PV);
+      } else if (name == "SearchAlgorithm" && value == "AlphaBeta") {
+        options.search_algorithm = ALPHA_BETA;
+      } else if (name == "SearchAlgorithm" && value == "MCTS") {
+        options.search_algorithm = MCTS;
+      } else if (name == "SearchAlgorithm") {
+        fmt::println("invalid value for option {}: '{}'", name, value);
+      } else if (name == "MCTSThreads") {
+        options.mcts_threads =
+            std::clamp(std::stoi(value), 1, MCTS_MAX_THREADS);
+      } else {
+        fmt::println("unknown option: '{}'", name);
+      }
+      update_mcts_memory(options, mcts_memory);
+    } catch (const std::logic_error &e) {
+      // std::stoi throws std::invalid_argument for values that aren't
+      // numbers and std::out_of_range for numbers that don't fit an int
+      fmt::println("invalid value for option {}: '{}'", name, value);
+    }
+    free(command.arg.option.name);
+    free(command.arg.option.value);
     break;
   }
   case Quit: {
@@ -1,14 +1,30 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 
 #include "board/board.hpp"
 #include "engine/command.hpp"
+#include "engine/history.hpp"
+#include "engine/mcts.hpp"
+#include "engine/transposition_table.hpp"
 
-const int MAX_DEPTH = 100;
 const int MAX_TIME = 3600000;
+const int MAX_MULTI_PV = 256;
+
+enum SearchAlgorithm { ALPHA_BETA, MCTS };
+
+// engine settings that can be changed with setoption
+struct Options {
+  int multi_pv;
+  SearchAlgorithm search_algorithm;
+  // only the Monte-Carlo tree search runs on more than one thread
+  int mcts_threads;
+};
 
 namespace engine {
 void execute_command(const Command &command, std::atomic<bool> &stop,
-                     Board &board);
+                     std::atomic<bool> &ponder, Board &board, History &history,
+                     TranspositionTable &tt, Options &options,
+                     std::unique_ptr<mcts::SearchMemory> &mcts_memory);
 };
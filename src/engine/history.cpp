@@ -0,0 +1,99 @@
+#include "history.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+int history_bonus(int depth) { return std::min(32 * depth * depth, 1200); }
+
+static size_t continuation_index(Color player, const Piece &previous,
+                                 PieceType piece_type, int end) {
+  return (((player * NR_PIECES + previous.piece_type) * 64 + previous.pos) *
+              NR_PIECES +
+          piece_type) *
+             64 +
+         end;
+}
+
+int get_history_score(const History &history, const Move &move,
+                      const Board &board) {
+  const Color player = board.get_player_to_move();
+  const std::optional<PieceType> piece_type = board.get_piece_type(move.start);
+  assert(piece_type.has_value());
+  int score = history.butterfly.at(player).at(move.start).at(move.end) +
+              history.piece_to.at(player).at(piece_type.value()).at(move.end);
+
+  for (int i = 0; i < NR_CONTINUATION_HISTORIES; i++) {
+    const std::optional<Piece> previous = board.get_moved_piece(i + 1);
+    if (previous.has_value()) {
+      score += history.continuation.at(i).at(continuation_index(
+          player, previous.value(), piece_type.value(), move.end));
+    }
+  }
+  return score;
+}
+
+// Add the bonus (or malus if negative) to the score, scaled down the closer
+// the score already is to MAX_HISTORY in that direction.
+// This keeps the score within bounds and lets recent cutoffs outweigh old ones.
+static void apply_gravity(int &score, int bonus) {
+  score += bonus - score * std::abs(bonus) / MAX_HISTORY;
+}
+
+void update_history(History &history, const Move &move, const Board &board,
+                    int bonus) {
+  const Color player = board.get_player_to_move();
+  const std::optional<PieceType> piece_type = board.get_piece_type(move.start);
+  assert(piece_type.has_value());
+  apply_gravity(history.butterfly.at(player).at(move.start).at(move.end),
+                bonus);
+  apply_gravity(history.piece_to.at(player).at(piece_type.value()).at(move.end),
+                bonus);
+
+  for (int i = 0; i < NR_CONTINUATION_HISTORIES; i++) {
+    const std::optional<Piece> previous = board.get_moved_piece(i + 1);
+    if (previous.has_value()) {
+      apply_gravity(history.continuation.at(i).at(continuation_index(
+                        player, previous.value(), piece_type.value(), move.end)),
+                    bonus);
+    }
+  }
+}
+
+std::optional<Move> get_countermove(const History &history,
+                                    const Board &board) {
+  const std::optional<Piece> previous = board.get_moved_piece(1);
+  if (!previous.has_value()) {
+    return std::nullopt;
+  }
+  const Piece &p = previous.value();
+  return history.countermoves.at(p.color).at(p.piece_type).at(p.pos);
+}
+
+void store_countermove(History &history, const Move &move, const Board &board) {
+  const std::optional<Piece> previous = board.get_moved_piece(1);
+  if (previous.has_value()) {
+    const Piece &p = previous.value();
+    history.countermoves.at(p.color).at(p.piece_type).at(p.pos) = move;
+  }
+}
+
+void age_history(History &history) {
+  for (int color = 0; color < 2; color++) {
+    for (auto &scores : history.butterfly.at(color)) {
+      for (int &score : scores) {
+        score /= 2;
+      }
+    }
+    for (auto &scores : history.piece_to.at(color)) {
+      for (int &score : scores) {
+        score /= 2;
+      }
+    }
+  }
+  for (std::vector<int> &scores : history.continuation) {
+    for (int &score : scores) {
+      score /= 2;
+    }
+  }
+}
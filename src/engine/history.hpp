@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "board/board.hpp"
+#include "move.hpp"
+
+// history scores stay within [-MAX_HISTORY, MAX_HISTORY]
+const int MAX_HISTORY = 16384;
+
+// the continuation histories look at the moves played this many plies ago
+const int NR_CONTINUATION_HISTORIES = 2;
+
+// indexed by [color][previous piece type][previous end][piece type][end],
+// flattened since it is too large to keep on the stack
+const size_t CONTINUATION_HISTORY_SIZE = 2 * NR_PIECES * 64 * NR_PIECES * 64;
+
+// how often quiet moves have caused beta cutoffs, used to order the quiet
+// moves that are neither the previous best move nor a killer move.
+// It is kept between searches and aged at the start of every iteration.
+struct History {
+  // indexed by [color][start][end]
+  std::array<std::array<std::array<int, 64>, 64>, 2> butterfly;
+  // indexed by [color][piece type][end]
+  std::array<std::array<std::array<int, 64>, NR_PIECES>, 2> piece_to;
+  // the move that refuted the opponent's last move,
+  // indexed by [color][piece type][end] of that last move
+  std::array<std::array<std::array<std::optional<Move>, 64>, NR_PIECES>, 2>
+      countermoves;
+  // the scores of moves in reply to the move played 1 and 2 plies ago
+  std::array<std::vector<int>, NR_CONTINUATION_HISTORIES> continuation = {
+      std::vector<int>(CONTINUATION_HISTORY_SIZE),
+      std::vector<int>(CONTINUATION_HISTORY_SIZE),
+  };
+};
+
+int history_bonus(int depth);
+int get_history_score(const History &history, const Move &move,
+                      const Board &board);
+void update_history(History &history, const Move &move, const Board &board,
+                    int bonus);
+std::optional<Move> get_countermove(const History &history,
+                                    const Board &board);
+void store_countermove(History &history, const Move &move, const Board &board);
+void age_history(History &history);
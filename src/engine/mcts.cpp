@@ -0,0 +1,478 @@
+#include "mcts.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fmt/core.h>
+#include <forward_list>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "board/board.hpp"
+#include "engine/move_sort.hpp"
+#include "engine/time_management.hpp"
+#include "engine/transposition_table.hpp"
+#include "move.hpp"
+
+namespace mcts {
+// nodes allocated up front for the tree, the tree stops growing when it
+// runs out
+const int NODE_POOL_SIZE = 1 << 20;
+const int ROOT = 0;
+
+// depth of the alpha-beta search that evaluates a new node
+const int EVALUATION_DEPTH = 2;
+// each thread's evaluation searches have a transposition table of this size
+const int EVALUATION_HASH_SIZE_MB = 16;
+
+// weight of the priors against the results when selecting a child
+const double C_PUCT = 1.5;
+// an unvisited child is assumed to be this much worse than its parent
+const double FPU_REDUCTION = 0.2;
+// the prior of a move falls off exponentially with its place in the move
+// ordering
+const double PRIOR_RANK_SCALE = 4.0;
+
+// shape of the curves that map a score to the chances of a win and a loss
+const double WDL_DRAW_MARGIN = 100;
+const double WDL_SCALE = 120;
+
+// milliseconds between info lines
+const int INFO_INTERVAL = 1000;
+
+// what the threads share
+struct Tree {
+  NodePool &pool;
+  // the threads run playouts until this is set
+  std::atomic<bool> done = false;
+  // the pool has run out of nodes, the playouts stop until the search ends
+  std::atomic<bool> full = false;
+  std::atomic<long> playouts = 0;
+  // sum of the depths of the leaves of the playouts
+  std::atomic<long> total_depth = 0;
+  std::atomic<int> seldepth = 0;
+};
+
+// what each thread has to itself
+struct Worker {
+  Board board;
+  History history;
+  TranspositionTable &tt;
+};
+
+void NodePool::clear() {
+  const int used = std::min(next.load(), (int)nodes.size());
+  for (int i = 0; i < used; i++) {
+    Node &node = nodes.at(i);
+    node.move = std::nullopt;
+    node.prior = 0;
+    node.first_child = 0;
+    node.nr_children = 0;
+    node.state = UNEXPANDED;
+    node.terminal_result = {0, 0, 0};
+    node.visits = 0;
+    node.virtual_loss = 0;
+    node.wins = 0;
+    node.losses = 0;
+  }
+  next = 0;
+}
+
+SearchMemory::SearchMemory(int nr_threads) : pool(NODE_POOL_SIZE) {
+  tables.reserve(nr_threads);
+  for (int i = 0; i < nr_threads; i++) {
+    tables.emplace_back(EVALUATION_HASH_SIZE_MB);
+  }
+}
+
+Wdl score_to_wdl(int score) {
+  if (score > CHECKMATE_THRESHOLD) {
+    return {1000, 0, 0};
+  }
+  if (score < -CHECKMATE_THRESHOLD) {
+    return {0, 0, 1000};
+  }
+  auto logistic = [](double x) { return 1 / (1 + std::exp(-x)); };
+  const int win =
+      std::round(1000 * logistic((score - WDL_DRAW_MARGIN) / WDL_SCALE));
+  const int loss =
+      std::round(1000 * logistic((-score - WDL_DRAW_MARGIN) / WDL_SCALE));
+  return {win, 1000 - win - loss, loss};
+}
+
+// the result for the other player
+static Wdl flip(const Wdl &wdl) { return {wdl.loss, wdl.draw, wdl.win}; }
+
+// average result of the playouts through the node, between -1 and 1 for the
+// player who made the move
+static double average_result(const Node &node) {
+  const int visits = node.visits.load(std::memory_order_relaxed);
+  if (visits == 0) {
+    return 0;
+  }
+  const long wins = node.wins.load(std::memory_order_relaxed);
+  const long losses = node.losses.load(std::memory_order_relaxed);
+  return (wins - losses) / 1000.0 / visits;
+}
+
+static Wdl average_wdl(const Node &node) {
+  const int visits = std::max(node.visits.load(std::memory_order_relaxed), 1);
+  const int win = node.wins.load(std::memory_order_relaxed) / visits;
+  const int loss = node.losses.load(std::memory_order_relaxed) / visits;
+  return {win, 1000 - win - loss, loss};
+}
+
+static bool is_terminal(const Node &node) {
+  return node.state.load(std::memory_order_acquire) == EXPANDED &&
+         node.nr_children == 0;
+}
+
+// the score for the player who made the move, on the scale of the alpha-beta
+// search
+static int score(const Node &node) {
+  // checkmate is the one result that is known for certain
+  if (is_terminal(node) && node.terminal_result.loss == 1000) {
+    return CHECKMATE - 1;
+  }
+  const double result = std::clamp(average_result(node), -0.999, 0.999);
+  return std::round(2 * WDL_SCALE * std::atanh(result));
+}
+
+// the child with the highest PUCT value, which adds to the average result of
+// a child a bonus for its prior that shrinks as it gets visited
+static int select_child(NodePool &pool, const Node &node) {
+  const int parent_visits = node.visits.load(std::memory_order_relaxed) +
+                            node.virtual_loss.load(std::memory_order_relaxed);
+  const double exploration = C_PUCT * std::sqrt(std::max(parent_visits, 1));
+  const double first_play_urgency = -average_result(node) - FPU_REDUCTION;
+  int best_child = node.first_child;
+  double best_value = -std::numeric_limits<double>::infinity();
+  for (int i = node.first_child; i < node.first_child + node.nr_children;
+       i++) {
+    const Node &child = pool.at(i);
+    const int visits = child.visits.load(std::memory_order_relaxed) +
+                       child.virtual_loss.load(std::memory_order_relaxed);
+    const double result =
+        visits == 0
+            ? first_play_urgency
+            : (child.wins.load(std::memory_order_relaxed) -
+               child.losses.load(std::memory_order_relaxed) -
+               1000.0 * child.virtual_loss.load(std::memory_order_relaxed)) /
+                  1000.0 / visits;
+    const double value = result + exploration * child.prior / (1 + visits);
+    if (value > best_value) {
+      best_value = value;
+      best_child = i;
+    }
+  }
+  return best_child;
+}
+
+static Wdl set_terminal(Node &node, const Wdl &result) {
+  node.terminal_result = result;
+  node.nr_children = 0;
+  node.state.store(EXPANDED, std::memory_order_release);
+  return result;
+}
+
+// Adds the children of the node and returns the result of its position for
+// the player to move. None when the pool has run out of nodes.
+static std::optional<Wdl> expand(Node &node, int ply_from_root,
+                                 const std::vector<Move> &search_moves,
+                                 Worker &worker, Tree &tree) {
+  Board &board = worker.board;
+  const bool is_root = ply_from_root == 0;
+  // the search is asked for a move even if the root position is a draw
+  if (!is_root && (board.is_insufficient_material() ||
+                   board.is_repetition(ply_from_root) ||
+                   board.is_draw_by_fifty_move_rule())) {
+    return set_terminal(node, {0, 1000, 0});
+  }
+  const std::vector<Move> moves = is_root && !search_moves.empty()
+                                ? search_moves
+                                : board.get_legal_moves();
+  if (moves.empty()) {
+    return board.is_in_check(board.get_player_to_move())
+               ? set_terminal(node, {0, 0, 1000})
+               : set_terminal(node, {0, 1000, 0});
+  }
+
+  const std::optional<int> first_child = tree.pool.allocate(moves.size());
+  if (!first_child.has_value()) {
+    node.state.store(UNEXPANDED, std::memory_order_release);
+    return std::nullopt;
+  }
+  // The priors come from the move ordering of the alpha-beta search. Moves
+  // with the same ordering score share the rank of the first of them, so
+  // that the quiet moves are alike until the history tells them apart.
+  ScoredMoves scored_moves = score_moves(moves, std::nullopt, KillerMoves{},
+                                         worker.history, board);
+  std::vector<double> weights;
+  double total_weight = 0;
+  int rank = 0;
+  for (int i = 0; i < moves.size(); i++) {
+    pick_move(scored_moves, i);
+    if (scored_moves.scores.at(i) != scored_moves.scores.at(rank)) {
+      rank = i;
+    }
+    weights.push_back(std::exp(-rank / PRIOR_RANK_SCALE));
+    total_weight += weights.back();
+  }
+  for (int i = 0; i < moves.size(); i++) {
+    Node &child = tree.pool.at(first_child.value() + i);
+    child.move = scored_moves.moves.at(i);
+    child.prior = weights.at(i) / total_weight;
+  }
+  node.first_child = first_child.value();
+  node.nr_children = moves.size();
+  node.state.store(EXPANDED, std::memory_order_release);
+
+  return score_to_wdl(search::shallow_search(board, EVALUATION_DEPTH,
+                                             worker.history, worker.tt));
+}
+
+// Follows the PUCT values from the root to a leaf, expands and evaluates the
+// leaf and adds its result to the nodes on the way
+static void playout(Worker &worker, Tree &tree,
+                    const std::vector<Move> &search_moves) {
+  std::vector<int> path = {ROOT};
+  Node *node = &tree.pool.at(ROOT);
+  node->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+  while (node->state.load(std::memory_order_acquire) == EXPANDED &&
+         node->nr_children > 0) {
+    const int child = select_child(tree.pool, *node);
+    node = &tree.pool.at(child);
+    worker.board.make(node->move.value());
+    node->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+    path.push_back(child);
+  }
+
+  std::optional<Wdl> result;
+  int unexpanded = UNEXPANDED;
+  if (is_terminal(*node)) {
+    result = node->terminal_result;
+  } else if (node->state.compare_exchange_strong(unexpanded, EXPANDING)) {
+    result = expand(*node, path.size() - 1, search_moves, worker, tree);
+    if (!result.has_value()) {
+      tree.full = true;
+    }
+  }
+  // Without a result another thread is expanding the leaf and the playout
+  // only takes back its virtual losses
+
+  // the nodes hold the results for the player who made the move
+  Wdl wdl = flip(result.value_or(Wdl{0, 0, 0}));
+  for (auto it = path.rbegin(); it != path.rend(); it++) {
+    Node &path_node = tree.pool.at(*it);
+    if (result.has_value()) {
+      path_node.wins.fetch_add(wdl.win, std::memory_order_relaxed);
+      path_node.losses.fetch_add(wdl.loss, std::memory_order_relaxed);
+      path_node.visits.fetch_add(1, std::memory_order_relaxed);
+    }
+    path_node.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+    wdl = flip(wdl);
+  }
+  for (int i = 1; i < path.size(); i++) {
+    worker.board.undo();
+  }
+
+  if (!result.has_value()) {
+    std::this_thread::yield();
+    return;
+  }
+  const int depth = path.size() - 1;
+  tree.playouts.fetch_add(1, std::memory_order_relaxed);
+  tree.total_depth.fetch_add(depth, std::memory_order_relaxed);
+  int seldepth = tree.seldepth.load(std::memory_order_relaxed);
+  while (depth > seldepth && !tree.seldepth.compare_exchange_weak(
+                                 seldepth, depth, std::memory_order_relaxed)) {
+  }
+}
+
+static int average_depth(const Tree &tree) {
+  const long playouts = tree.playouts.load(std::memory_order_relaxed);
+  return std::round(
+      (double)tree.total_depth.load(std::memory_order_relaxed) /
+      std::max(playouts, 1L));
+}
+
+// the children of the node from the most to the least visited
+static std::vector<int> children_by_visits(NodePool &pool, const Node &node) {
+  // the visits keep changing while the other threads run, so they are read
+  // once before sorting
+  std::vector<std::pair<int, int>> children;
+  for (int i = node.first_child; i < node.first_child + node.nr_children;
+       i++) {
+    children.push_back({i, pool.at(i).visits.load(std::memory_order_relaxed)});
+  }
+  std::stable_sort(
+      children.begin(), children.end(),
+      [](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+        return a.second > b.second;
+      });
+  std::vector<int> indices;
+  for (const auto &[index, visits] : children) {
+    indices.push_back(index);
+  }
+  return indices;
+}
+
+// the moves from the node on, following the most visited children
+static std::forward_list<Move> principal_variation(NodePool &pool,
+                                                   int index) {
+  std::vector<Move> moves;
+  while (true) {
+    const Node &node = pool.at(index);
+    moves.push_back(node.move.value());
+    if (node.state.load(std::memory_order_acquire) != EXPANDED ||
+        node.nr_children == 0) {
+      break;
+    }
+    index = children_by_visits(pool, node).front();
+    if (pool.at(index).visits.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+  }
+  return std::forward_list<Move>(moves.begin(), moves.end());
+}
+
+// the lines that start with the most visited root moves
+static std::vector<SearchSummary>
+get_lines(Tree &tree, int multi_pv,
+          std::chrono::time_point<std::chrono::high_resolution_clock>
+              start_time) {
+  const std::vector<int> root_children =
+      children_by_visits(tree.pool, tree.pool.at(ROOT));
+  const int nr_lines = std::min(multi_pv, (int)root_children.size());
+  std::vector<SearchSummary> lines;
+  for (int line = 0; line < nr_lines; line++) {
+    const Node &child = tree.pool.at(root_children.at(line));
+    const Wdl wdl = average_wdl(child);
+    lines.push_back({
+        .depth = std::max(average_depth(tree), 1),
+        .seldepth = tree.seldepth.load(std::memory_order_relaxed),
+        .multipv = line + 1,
+        .score = score(child),
+        .nodes = tree.playouts.load(std::memory_order_relaxed),
+        .time = time_elapsed(start_time),
+        .pv = principal_variation(tree.pool, root_children.at(line)),
+        .wdl = std::array<int, 3>{wdl.win, wdl.draw, wdl.loss},
+    });
+  }
+  return lines;
+}
+
+std::vector<SearchSummary> search(Board &board, const History &history,
+                                  const SearchLimits &limits,
+                                  SearchMemory &memory,
+                                  std::atomic<bool> &stop,
+                                  std::atomic<bool> &ponder) {
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  auto move_start_time = start_time;
+  memory.pool.clear();
+  Tree tree = {.pool = memory.pool};
+  tree.pool.allocate(1);
+  const int nr_threads = memory.tables.size();
+  std::vector<Worker> workers;
+  workers.reserve(nr_threads);
+  for (TranspositionTable &tt : memory.tables) {
+    tt.clear();
+    workers.push_back({.board = board, .history = history, .tt = tt});
+  }
+
+  // the first playout expands the root before the other threads start
+  playout(workers.front(), tree, limits.search_moves);
+  assert(tree.pool.at(ROOT).nr_children > 0);
+  // A full pool doesn't end the search, as infinite searches and pondering
+  // may only end with stop, it only ends the playouts
+  auto run_playout = [&](Worker &worker) {
+    if (tree.full.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } else {
+      playout(worker, tree, limits.search_moves);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < nr_threads; i++) {
+    threads.emplace_back([&, i] {
+      while (!tree.done.load(std::memory_order_relaxed)) {
+        run_playout(workers.at(i));
+      }
+    });
+  }
+
+  auto limit_reached = [&] {
+    if (stop.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    if (limits.max_nodes.has_value() &&
+        tree.playouts.load(std::memory_order_relaxed) >=
+            limits.max_nodes.value()) {
+      return true;
+    }
+    if (average_depth(tree) >= limits.depth) {
+      return true;
+    }
+    if (ponder.load(std::memory_order_relaxed)) {
+      move_start_time = std::chrono::high_resolution_clock::now();
+      return false;
+    }
+    // like the alpha-beta search, stop early when most of the effort goes
+    // to the best move anyway
+    if (limits.flexible_time) {
+      const Node &root = tree.pool.at(ROOT);
+      const int best_child = children_by_visits(tree.pool, root).front();
+      const double best_move_visits_share =
+          (double)tree.pool.at(best_child).visits /
+          std::max(root.visits.load(std::memory_order_relaxed), 1);
+      if (can_stop_early(time_elapsed(move_start_time), limits.allocated_time,
+                         best_move_visits_share)) {
+        return true;
+      }
+    }
+    return time_elapsed(move_start_time) > limits.allocated_time;
+  };
+  std::vector<SearchSummary> search_summaries;
+  int last_info_time = 0;
+  while (!limit_reached()) {
+    run_playout(workers.front());
+    if (time_elapsed(start_time) - last_info_time >= INFO_INTERVAL) {
+      last_info_time = time_elapsed(start_time);
+      for (const SearchSummary &line :
+           get_lines(tree, limits.multi_pv, start_time)) {
+        fmt::println("{}", uci::show(line));
+        search_summaries.push_back(line);
+      }
+      std::flush(std::cout);
+    }
+  }
+  tree.done = true;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  const std::vector<SearchSummary> lines =
+      get_lines(tree, limits.multi_pv, start_time);
+  for (const SearchSummary &line : lines) {
+    fmt::println("{}", uci::show(line));
+    search_summaries.push_back(line);
+  }
+  for (int index : children_by_visits(tree.pool, tree.pool.at(ROOT))) {
+    const Node &child = tree.pool.at(index);
+    const Wdl wdl = average_wdl(child);
+    fmt::println("info string {} visits {} wdl {} {} {}",
+                 child.move.value().to_uci_notation(), child.visits.load(),
+                 wdl.win, wdl.draw, wdl.loss);
+  }
+  std::flush(std::cout);
+
+  assert(!lines.empty());
+  search::send_bestmove(lines.front().pv, stop, ponder);
+  return search_summaries;
+}
+} // namespace mcts
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "board/board.hpp"
+#include "engine/history.hpp"
+#include "engine/search.hpp"
+#include "engine/transposition_table.hpp"
+#include "move.hpp"
+#include "uci.hpp"
+
+const int MCTS_MAX_THREADS = 64;
+
+// chances of a result in thousandths, they add up to 1000
+struct Wdl {
+  int win;
+  int draw;
+  int loss;
+};
+
+namespace mcts {
+enum NodeState { UNEXPANDED, EXPANDING, EXPANDED };
+
+struct Node {
+  // the move that leads to the node, none for the root
+  std::optional<Move> move;
+  // how promising the move looked before it was visited
+  double prior = 0;
+  // the children are consecutive in the pool
+  int first_child = 0;
+  int nr_children = 0;
+  // the thread that changes the state from UNEXPANDED to EXPANDING is the
+  // only one to write the fields above, before it sets it to EXPANDED
+  std::atomic<int> state = UNEXPANDED;
+  // for an expanded node without children, the result for the player to move
+  Wdl terminal_result = {0, 0, 0};
+  std::atomic<int> visits = 0;
+  // playouts that are still on their way through the node. They count as
+  // losses until they are backed up so that the threads spread out over the
+  // tree instead of all following the same path.
+  std::atomic<int> virtual_loss = 0;
+  // sums of the results of the playouts in thousandths, for the player who
+  // made the move. The draws are what remains of the visits.
+  std::atomic<long> wins = 0;
+  std::atomic<long> losses = 0;
+};
+
+// Storage for the nodes of the tree. Nodes are taken from it without locking
+// so that all threads can grow the tree at the same time.
+class NodePool {
+public:
+  NodePool(int size) : nodes(size), next(0) {}
+
+  // the index of the first of nr_nodes consecutive nodes, none when the pool
+  // has run out of nodes
+  std::optional<int> allocate(int nr_nodes) {
+    const int first = next.fetch_add(nr_nodes, std::memory_order_relaxed);
+    if (first + nr_nodes > (int)nodes.size()) {
+      return std::nullopt;
+    }
+    return first;
+  }
+
+  Node &at(int index) { return nodes.at(index); }
+  // makes the nodes that were handed out available again
+  void clear();
+
+private:
+  std::vector<Node> nodes;
+  std::atomic<int> next;
+};
+
+// The tree and the transposition tables of the evaluation searches, one for
+// each thread. They are too large to allocate for every move, so they are
+// allocated when the options are set and cleared at the start of a search.
+struct SearchMemory {
+  NodePool pool;
+  std::vector<TranspositionTable> tables;
+
+  SearchMemory(int nr_threads);
+};
+
+// the expected result for the player to move of a position with the score
+Wdl score_to_wdl(int score);
+
+// Monte-Carlo tree search in which every new node is evaluated with a
+// shallow alpha-beta search instead of a random playout. The depth limit
+// applies to the average depth of the playouts and the node limit to the
+// number of playouts.
+std::vector<SearchSummary> search(Board &board, const History &history,
+                                  const SearchLimits &limits,
+                                  SearchMemory &memory,
+                                  std::atomic<bool> &stop,
+                                  std::atomic<bool> &ponder);
+}; // namespace mcts
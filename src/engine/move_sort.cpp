@@ -4,36 +4,112 @@
 #include "evaluation/evaluation.hpp"
 #include "move_sort.hpp"
 
-static int
-move_score(const Move &move, const std::optional<Move> &best_move_prev_depth,
-           std::unordered_set<Move, Move::HashFunction> &killer_moves,
-           const Board &board) {
+bool is_killer_move(const Move &move, const KillerMoves &killer_moves) {
+  return std::find(killer_moves.begin(), killer_moves.end(), move) !=
+         killer_moves.end();
+}
+
+// Moves are ordered in tiers. The scores within a tier only decide the order
+// of the moves in that tier, so the tiers are far enough apart to never
+// overlap.
+const int BEST_MOVE_PREV_DEPTH_SCORE = 4000000;
+const int GOOD_CAPTURE_SCORE = 3000000;
+const int KILLER_MOVE_SCORE = 2000000;
+const int COUNTERMOVE_SCORE = KILLER_MOVE_SCORE - 1;
+// quiet moves are scored by their history score around 0
+const int BAD_CAPTURE_SCORE = -2000000;
+
+static int move_score(const Move &move,
+                      const std::optional<Move> &best_move_prev_depth,
+                      const KillerMoves &killer_moves,
+                      const std::optional<Move> &countermove,
+                      bool losing_capture, const History &history,
+                      const Board &board) {
   if (best_move_prev_depth.has_value() &&
       move == best_move_prev_depth.value()) {
-    return QUEEN_VALUE;
+    return BEST_MOVE_PREV_DEPTH_SCORE;
+  }
+
+  if (is_killer_move(move, killer_moves)) {
+    return KILLER_MOVE_SCORE;
   }
 
-  if (killer_moves.contains(move)) {
-    return 0;
+  if (countermove.has_value() && move == countermove.value()) {
+    return COUNTERMOVE_SCORE;
   }
 
   const std::optional<PieceType> start_piece = board.get_piece_type(move.start);
-  const std::optional<PieceType> end_piece = board.get_piece_type(move.end);
+  const std::optional<PieceType> end_piece =
+      move.move_type == EN_PASSANT ? std::optional<PieceType>(PAWN)
+                                   : board.get_piece_type(move.end);
 
-  // score non-capture moves lower than captures
+  // order non-capture moves among themselves by their history score
   if (!end_piece.has_value()) {
-    return -QUEEN_VALUE;
+    return get_history_score(history, move, board);
   }
-  return PIECE_VALUES.at(end_piece.value()) -
-         PIECE_VALUES.at(start_piece.value());
+
+  // captures that lose material are tried after the quiet moves
+  const int mvv_lva = PIECE_VALUES.at(end_piece.value()) -
+                      PIECE_VALUES.at(start_piece.value());
+  return (losing_capture ? BAD_CAPTURE_SCORE : GOOD_CAPTURE_SCORE) + mvv_lva;
+}
+
+void store_killer_move(KillerMoves &killer_moves, const Move &move) {
+  if (killer_moves.front() == move) {
+    return;
+  }
+  // shift the older killers down a slot, dropping the oldest one
+  std::move_backward(killer_moves.begin(), killer_moves.end() - 1,
+                     killer_moves.end());
+  killer_moves.front() = move;
+}
+
+// Every move is scored once. The moves are then ordered lazily with
+// pick_move because after a cutoff the remaining moves don't need to be
+// ordered at all.
+ScoredMoves score_moves(std::vector<Move> moves,
+                        const std::optional<Move> &best_move_prev_depth,
+                        const KillerMoves &killer_moves,
+                        const History &history, const Board &board) {
+  const std::optional<Move> countermove = get_countermove(history, board);
+  std::vector<int> scores;
+  scores.reserve(moves.size());
+  std::vector<bool> losing_captures;
+  losing_captures.reserve(moves.size());
+  for (const Move &move : moves) {
+    const bool is_capture = board.get_piece_type(move.end).has_value() ||
+                            move.move_type == EN_PASSANT;
+    const bool losing_capture = is_capture && !board.see(move, 0);
+    scores.push_back(move_score(move, best_move_prev_depth, killer_moves,
+                                countermove, losing_capture, history, board));
+    losing_captures.push_back(losing_capture);
+  }
+  return {.moves = std::move(moves),
+          .scores = std::move(scores),
+          .losing_captures = std::move(losing_captures)};
+}
+
+// Moves the best of the moves from index onwards to index and returns it.
+// Picking the indices in increasing order yields the moves from best to worst.
+const Move &pick_move(ScoredMoves &scored_moves, int index) {
+  std::vector<int> &scores = scored_moves.scores;
+  const int best_index =
+      std::max_element(scores.begin() + index, scores.end()) - scores.begin();
+  std::swap(scores.at(index), scores.at(best_index));
+  std::swap(scored_moves.moves.at(index), scored_moves.moves.at(best_index));
+  std::vector<bool>::swap(scored_moves.losing_captures.at(index),
+                          scored_moves.losing_captures.at(best_index));
+  return scored_moves.moves.at(index);
 }
 
 void sort_moves(std::vector<Move> &moves,
                 const std::optional<Move> &best_move_prev_depth,
-                std::unordered_set<Move, Move::HashFunction> &killer_moves,
+                const KillerMoves &killer_moves, const History &history,
                 const Board &board) {
-  std::sort(moves.begin(), moves.end(), [&](Move i, Move j) {
-    return move_score(i, best_move_prev_depth, killer_moves, board) >
-           move_score(j, best_move_prev_depth, killer_moves, board);
-  });
+  ScoredMoves scored_moves = score_moves(std::move(moves), best_move_prev_depth,
+                                         killer_moves, history, board);
+  for (int i = 0; i < scored_moves.moves.size(); i++) {
+    pick_move(scored_moves, i);
+  }
+  moves = std::move(scored_moves.moves);
 }
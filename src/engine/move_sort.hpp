@@ -1,11 +1,37 @@
 #pragma once
 
 #include "board/board.hpp"
+#include "engine/history.hpp"
 #include "move.hpp"
-#include <unordered_set>
+#include <array>
+#include <optional>
 #include <vector>
 
+const int NR_KILLER_MOVES = 2;
+
+// quiet moves that caused a beta cutoff at the same ply,
+// the most recent one first
+using KillerMoves = std::array<std::optional<Move>, NR_KILLER_MOVES>;
+
+bool is_killer_move(const Move &move, const KillerMoves &killer_moves);
+void store_killer_move(KillerMoves &killer_moves, const Move &move);
+
+// the moves of a position together with their ordering scores
+struct ScoredMoves {
+  std::vector<Move> moves;
+  std::vector<int> scores;
+  // whether the static exchange evaluation of the move is negative, so that
+  // the search doesn't have to repeat it
+  std::vector<bool> losing_captures;
+};
+
+ScoredMoves score_moves(std::vector<Move> moves,
+                        const std::optional<Move> &best_move_prev_depth,
+                        const KillerMoves &killer_moves,
+                        const History &history, const Board &board);
+const Move &pick_move(ScoredMoves &scored_moves, int index);
+
 void sort_moves(std::vector<Move> &moves,
                 const std::optional<Move> &best_move_prev_depth,
-                std::unordered_set<Move, Move::HashFunction> &killer_moves,
+                const KillerMoves &killer_moves, const History &history,
                 const Board &board);
@@ -3,48 +3,113 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <fmt/core.h>
 #include <forward_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <ostream>
+#include <thread>
 #include <vector>
 
 #include "board/board.hpp"
 #include "engine/move_sort.hpp"
+#include "engine/time_management.hpp"
 #include "evaluation/evaluation.hpp"
 #include "move.hpp"
 #include "uci.hpp"
 
 namespace search {
-static int time_elapsed(
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time) {
-  auto now = std::chrono::high_resolution_clock::now();
-  return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time)
-      .count();
+// Reading the clock is relatively expensive for how often this is called,
+// so it is only read every TIME_CHECK_INTERVAL calls
+static bool terminate_search(const SearchParams &params, SearchInfo &info) {
+  // depth-1 search must have been completed so we can output a move
+  if (params.depth < 2) {
+    return false;
+  }
+  if (params.stop.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (params.max_nodes.has_value() && info.nodes >= params.max_nodes.value()) {
+    return true;
+  }
+  if (!info.out_of_time &&
+      ++info.calls_since_time_check >= TIME_CHECK_INTERVAL) {
+    info.calls_since_time_check = 0;
+    if (params.ponder.load(std::memory_order_relaxed)) {
+      info.move_start_time = std::chrono::high_resolution_clock::now();
+    } else {
+      info.out_of_time =
+          time_elapsed(info.move_start_time) > params.allocated_time;
+    }
+  }
+  return info.out_of_time;
 }
 
-static bool terminate_search(SearchParams params) {
-  bool out_of_time = time_elapsed(params.start_time) > params.allocated_time;
-  // depth-1 search must have been completed so we can output a move
-  return params.depth >= 2 && (params.stop || out_of_time);
+// the result of the position if the transposition table entry is enough to
+// decide it for the window
+static std::optional<std::pair<int, std::forward_list<Move>>>
+tt_cutoff(const TTEntry &tt_entry, int alpha, int beta, int ply_from_root) {
+  const int tt_score = score_from_tt(tt_entry.score, ply_from_root);
+  if (tt_entry.bound == LOWER_BOUND && tt_score >= beta) {
+    return std::make_pair(beta, std::forward_list<Move>{});
+  }
+  if (tt_entry.bound == UPPER_BOUND && tt_score <= alpha) {
+    return std::make_pair(alpha, std::forward_list<Move>{});
+  }
+  if (tt_entry.bound == EXACT) {
+    const std::optional<Move> &tt_move = tt_entry.best_move;
+    std::forward_list<Move> variation = {};
+    if (tt_score > alpha && tt_score < beta && tt_move.has_value()) {
+      variation.push_front(tt_move.value());
+    }
+    return std::make_pair(std::clamp(tt_score, alpha, beta), variation);
+  }
+  return std::nullopt;
+}
+
+// the static evaluation cached in the transposition table entry if there is
+// one, as evaluating the position is expensive
+static int static_evaluation(const std::optional<TTEntry> &tt_entry,
+                             const Board &board) {
+  if (tt_entry.has_value() && tt_entry.value().static_eval.has_value()) {
+    return tt_entry.value().static_eval.value();
+  }
+  return evaluate(board);
 }
 
 static std::optional<std::pair<int, std::forward_list<Move>>>
 quiescence(int alpha, int beta, int ply_from_root, int quiescence_plies,
            Board &board, const SearchParams &params, SearchInfo &info) {
   info.seldepth = std::max(ply_from_root, info.seldepth);
+  info.nodes++;
 
-  if (terminate_search(params)) {
+  if (terminate_search(params, info)) {
     return std::nullopt;
   }
 
-  if (board.is_insufficient_material() || board.is_threefold_repetition() ||
+  if (ply_from_root >= MAX_PLY - 1) {
+    return std::make_pair(evaluate(board), std::forward_list<Move>{});
+  }
+
+  if (board.is_insufficient_material() || board.is_repetition(ply_from_root) ||
       board.is_draw_by_fifty_move_rule()) {
     return std::make_pair(DRAW, std::forward_list<Move>{});
   }
 
+  // Capture sequences transpose a lot, so the quiescence search uses the
+  // transposition table as well. Any earlier result is at least as deep.
+  const uint64_t key = board.get_zobrist_key();
+  const std::optional<TTEntry> tt_entry = info.tt.probe(key);
+  if (tt_entry.has_value()) {
+    auto res = tt_cutoff(tt_entry.value(), alpha, beta, ply_from_root);
+    if (res.has_value()) {
+      return res;
+    }
+  }
+
   std::vector<Move> legal_moves = board.get_legal_moves();
   const bool in_check = board.is_in_check(board.get_player_to_move());
   if (legal_moves.empty()) {
@@ -74,27 +139,88 @@ quiescence(int alpha, int beta, int ply_from_root, int quiescence_plies,
   const int QUIESCENCE_CHECKS_MAX_PLY = 1;
   const bool extend_search =
       in_check && quiescence_plies < QUIESCENCE_CHECKS_MAX_PLY;
+  // Delta pruning: skip captures that can't bring the evaluation back up to
+  // alpha even with a safety margin. With little material left, positional
+  // factors can outweigh the material so the margin is not reliable.
+  const int DELTA_MARGIN = 200;
+  const int DELTA_PRUNING_MIN_MATERIAL = 2 * ROOK_VALUE;
+  const int non_pawn_material = board.get_non_pawn_material(WHITE) +
+                                board.get_non_pawn_material(BLACK);
+  const bool delta_pruning =
+      !in_check && non_pawn_material > DELTA_PRUNING_MIN_MATERIAL;
+  // Positions in check are not stored, as their result depends on how many
+  // checks were already extended on the path to them
+  const bool store_in_tt = !in_check;
+  const int original_alpha = alpha;
+  int stand_pat = -CHECKMATE;
   if (!extend_search) {
-    info.nodes++;
-    const int evaluation = evaluate(board);
-    if (evaluation >= beta) {
+    stand_pat = static_evaluation(tt_entry, board);
+    if (stand_pat >= beta) {
+      if (store_in_tt) {
+        info.tt.store({
+            .key = key,
+            .depth = 0,
+            .score = score_to_tt(beta, ply_from_root),
+            .bound = LOWER_BOUND,
+            .best_move = std::nullopt,
+            .static_eval = stand_pat,
+        });
+      }
       return std::make_pair(beta, std::forward_list<Move>{});
     }
-    if (evaluation > alpha) {
-      alpha = evaluation;
+    if (stand_pat > alpha) {
+      alpha = stand_pat;
+    }
+
+    // not even capturing a queen would be enough
+    const int max_gain =
+        QUEEN_VALUE +
+        (board.has_pawns_about_to_promote(board.get_player_to_move())
+             ? QUEEN_VALUE - PAWN_VALUE
+             : 0);
+    if (delta_pruning && stand_pat + max_gain + DELTA_MARGIN <= alpha) {
+      return std::make_pair(alpha, std::forward_list<Move>{});
     }
   }
 
   std::vector<Move> moves =
       extend_search ? legal_moves : board.get_forcing_moves(legal_moves);
-  std::unordered_set<Move, Move::HashFunction> killer_moves = {};
-  sort_moves(moves, std::nullopt, killer_moves, board);
+  const std::optional<Move> tt_move =
+      tt_entry.has_value() ? tt_entry.value().best_move : std::nullopt;
+  ScoredMoves scored_moves = score_moves(std::move(moves), tt_move,
+                                         KillerMoves{}, info.history, board);
   std::forward_list<Move> principal_variation = {};
-  for (const Move &move : moves) {
+  std::optional<Move> best_move = std::nullopt;
+  for (int move_number = 0; move_number < scored_moves.moves.size();
+       move_number++) {
+    const Move &move = pick_move(scored_moves, move_number);
+    // captures that lose material are very unlikely to improve on the
+    // static evaluation the side to move can already settle for
+    const std::optional<PieceType> captured = board.get_piece_type(move.end);
+    if (!extend_search && captured.has_value() &&
+        scored_moves.losing_captures.at(move_number)) {
+      continue;
+    }
+
+    if (delta_pruning &&
+        (captured.has_value() || move.move_type == PROMOTION)) {
+      const int gain =
+          (captured.has_value() ? PIECE_VALUES.at(captured.value()) : 0) +
+          (move.move_type == PROMOTION
+               ? PIECE_VALUES.at(move.promotion_piece.value()) - PAWN_VALUE
+               : 0);
+      if (stand_pat + gain + DELTA_MARGIN <= alpha) {
+        continue;
+      }
+    }
+
     board.make(move);
     auto res = quiescence(-beta, -alpha, ply_from_root + 1,
                           quiescence_plies + 1, board, params, info);
+    // an aborted search takes back its moves on the way out so that the
+    // board is left as it was
     if (!res.has_value()) {
+      board.undo();
       return std::nullopt;
     }
     const int evaluation = -res.value().first;
@@ -103,25 +229,130 @@ quiescence(int alpha, int beta, int ply_from_root, int quiescence_plies,
     board.undo();
 
     if (evaluation >= beta) {
+      if (store_in_tt) {
+        info.tt.store({
+            .key = key,
+            .depth = 0,
+            .score = score_to_tt(beta, ply_from_root),
+            .bound = LOWER_BOUND,
+            .best_move = move,
+            .static_eval = stand_pat,
+        });
+      }
       return std::make_pair(beta, variation);
     }
     if (evaluation > alpha) {
       alpha = evaluation;
       principal_variation = variation;
+      best_move = move;
     }
   }
+
+  if (store_in_tt) {
+    info.tt.store({
+        .key = key,
+        .depth = 0,
+        .score = score_to_tt(alpha, ply_from_root),
+        .bound = alpha > original_alpha ? EXACT : UPPER_BOUND,
+        .best_move = best_move,
+        .static_eval = stand_pat,
+    });
+  }
   return std::make_pair(alpha, principal_variation);
 }
 
+const int LMR_MIN_DEPTH = 3;
+const int LMR_MIN_MOVES = 3;
+const int LMR_MAX_MOVES = 64;
+
+// how many plies to reduce a late move by, indexed by [depth][move number]
+static std::array<std::array<int, LMR_MAX_MOVES>, MAX_DEPTH + 1>
+late_move_reductions() {
+  std::array<std::array<int, LMR_MAX_MOVES>, MAX_DEPTH + 1> reductions;
+  for (int depth = 0; depth <= MAX_DEPTH; depth++) {
+    for (int move_number = 0; move_number < LMR_MAX_MOVES; move_number++) {
+      reductions.at(depth).at(move_number) =
+          depth == 0 || move_number == 0
+              ? 0
+              : 0.75 + std::log(depth) * std::log(move_number) / 2.25;
+    }
+  }
+  return reductions;
+}
+
+static const std::array<std::array<int, LMR_MAX_MOVES>, MAX_DEPTH + 1>
+    LATE_MOVE_REDUCTIONS = late_move_reductions();
+
+// extensions are counted in fractions of a ply
+const int ONE_PLY = 4;
+const int CHECK_EXTENSION = ONE_PLY;
+const int PAWN_PUSH_EXTENSION = ONE_PLY * 3 / 4;
+const int RECAPTURE_EXTENSION = ONE_PLY / 2;
+
+// how much to extend the search after the move that was just made
+static int extension(bool gives_check, bool is_recapture, const Board &board) {
+  int extension = 0;
+  if (gives_check) {
+    extension += CHECK_EXTENSION;
+  }
+  if (is_recapture) {
+    extension += RECAPTURE_EXTENSION;
+  }
+
+  const std::optional<Piece> moved_piece = board.get_moved_piece(1);
+  assert(moved_piece.has_value());
+  const int seventh_rank = moved_piece.value().color == WHITE ? 1 : 6;
+  if (moved_piece.value().piece_type == PAWN &&
+      moved_piece.value().pos >> 3 == seventh_rank) {
+    extension += PAWN_PUSH_EXTENSION;
+  }
+  return extension;
+}
+
+// The side to move might be in zugzwang if it only has pawns left,
+// in which case passing the turn would be better than any legal move
+static bool null_move_allowed(const Board &board) {
+  return board.get_non_pawn_material(board.get_player_to_move()) > 0;
+}
+
+// the root moves are ordered by what the earlier iterations found out about
+// them instead of by the usual move scores
+static void order_root_moves(ScoredMoves &scored_moves,
+                             const std::vector<RootMove> &root_move_list) {
+  for (int i = 0; i < scored_moves.moves.size(); i++) {
+    const Move &move = scored_moves.moves.at(i);
+    auto it = std::find_if(root_move_list.begin(), root_move_list.end(),
+                           [&](const RootMove &rm) { return rm.move == move; });
+    scored_moves.scores.at(i) = -std::distance(root_move_list.begin(), it);
+  }
+}
+
+static void update_root_move(std::vector<RootMove> &root_move_list,
+                             const Move &move, int score, long nodes) {
+  auto it = std::find_if(root_move_list.begin(), root_move_list.end(),
+                         [&](const RootMove &rm) { return rm.move == move; });
+  assert(it != root_move_list.end());
+  it->score = score;
+  it->nodes += nodes;
+}
+
 static std::optional<std::pair<int, std::forward_list<Move>>>
 alpha_beta(int depth, int alpha, int beta, int ply_from_root, Board &board,
-           const SearchParams &params, SearchInfo &info) {
+           const SearchParams &params, SearchInfo &info, int extension_units,
+           bool allow_null_move = true) {
   info.seldepth = std::max(ply_from_root, info.seldepth);
+  info.nodes++;
 
-  if (terminate_search(params)) {
+  if (terminate_search(params, info)) {
     return std::nullopt;
   }
 
+  if (ply_from_root >= MAX_PLY - 1) {
+    return std::make_pair(evaluate(board), std::forward_list<Move>{});
+  }
+  SearchStackEntry &stack_entry = info.stack.at(ply_from_root);
+  const std::optional<Move> excluded_move = stack_entry.excluded_move;
+
   // after the search has concluded,
   // see if there are any winning/losing forcing moves in the position
   // that might change the evaluation of the position
@@ -129,18 +360,183 @@ alpha_beta(int depth, int alpha, int beta, int ply_from_root, Board &board,
     return quiescence(alpha, beta, ply_from_root, 0, board, params, info);
   }
 
-  if (board.is_insufficient_material() || board.is_threefold_repetition() ||
+  if (board.is_insufficient_material() || board.is_repetition(ply_from_root) ||
       board.is_draw_by_fifty_move_rule()) {
     return std::make_pair(DRAW, std::forward_list<Move>{});
   }
 
+  // Mate distance pruning: even mating the opponent on the next move can't be
+  // better than a shorter mate that was already found, and being mated on
+  // the next move can't be worse than a shorter mate that can be avoided
+  if (ply_from_root > 0) {
+    alpha = std::max(alpha, -CHECKMATE + ply_from_root);
+    beta = std::min(beta, CHECKMATE - ply_from_root - 1);
+    if (alpha >= beta) {
+      return std::make_pair(alpha, std::forward_list<Move>{});
+    }
+  }
+
+  // if the player to move can repeat an earlier position of the search,
+  // it can at least hold the draw
+  if (ply_from_root > 0 && alpha < DRAW &&
+      board.has_upcoming_repetition(ply_from_root)) {
+    alpha = DRAW;
+    if (alpha >= beta) {
+      return std::make_pair(alpha, std::forward_list<Move>{});
+    }
+  }
+
+  // the result of an earlier search of the same position can be reused if
+  // it was searched at least as deep as the current depth.
+  // The search excluding a move must not see the result of the full search.
+  const std::optional<TTEntry> tt_entry =
+      excluded_move.has_value()
+          ? std::nullopt
+          : info.tt.probe(board.get_zobrist_key());
+  const std::optional<Move> tt_move =
+      tt_entry.has_value() ? tt_entry.value().best_move : std::nullopt;
+  const int tt_score =
+      tt_entry.has_value()
+          ? score_from_tt(tt_entry.value().score, ply_from_root)
+          : 0;
+  if (tt_entry.has_value() && ply_from_root > 0 &&
+      tt_entry.value().depth >= depth) {
+    auto res = tt_cutoff(tt_entry.value(), alpha, beta, ply_from_root);
+    if (res.has_value()) {
+      return res;
+    }
+  }
+
   std::vector<Move> moves = board.get_legal_moves();
+  const bool in_check = board.is_in_check(board.get_player_to_move());
   if (moves.empty()) {
-    const int eval = board.is_in_check(board.get_player_to_move())
-                         ? -CHECKMATE + ply_from_root
-                         : DRAW;
+    const int eval = in_check ? -CHECKMATE + ply_from_root : DRAW;
     return std::make_pair(eval, std::forward_list<Move>{});
   }
+  if (ply_from_root == 0 && !params.root_moves.empty()) {
+    moves = params.root_moves;
+  }
+  // The result of a search restricted to some of the root moves says nothing
+  // about the position itself, so it must not be stored
+  const bool store_in_tt = !excluded_move.has_value() &&
+                           (ply_from_root > 0 || params.root_moves.empty());
+
+  const int static_eval = static_evaluation(tt_entry, board);
+  stack_entry.static_eval =
+      in_check ? std::nullopt : std::make_optional(static_eval);
+  // whether the position got better for the side to move since its last move,
+  // in which case fail highs are more likely and less should be pruned.
+  // Without a previous evaluation to compare to, assume it did.
+  const std::optional<int> prev_static_eval =
+      ply_from_root >= 2 ? info.stack.at(ply_from_root - 2).static_eval
+                         : std::nullopt;
+  const bool improving = !prev_static_eval.has_value() ||
+                         static_eval > prev_static_eval.value();
+  const bool mate_bounds = std::abs(alpha) >= CHECKMATE_THRESHOLD ||
+                           std::abs(beta) >= CHECKMATE_THRESHOLD;
+  const bool is_pv_node = beta - alpha > 1;
+
+  // Reverse futility pruning: close to the horizon, if the static evaluation
+  // is so far above beta that the opponent is unlikely to recover in the
+  // remaining plies, assume the node fails high
+  const int REVERSE_FUTILITY_MAX_DEPTH = 3;
+  const int REVERSE_FUTILITY_MARGIN = 120;
+  if (ply_from_root > 0 && !in_check && !mate_bounds &&
+      !excluded_move.has_value() && depth <= REVERSE_FUTILITY_MAX_DEPTH &&
+      static_eval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+    return std::make_pair(beta, std::forward_list<Move>{});
+  }
+
+  // Razoring: when the static evaluation is far below alpha close to the
+  // horizon, only captures have a chance to recover, so if the quiescence
+  // search confirms the fail low, the node is not searched any further
+  const int RAZORING_MAX_DEPTH = 2;
+  const int RAZORING_MARGIN = 250;
+  if (ply_from_root > 0 && !is_pv_node && !in_check && !mate_bounds &&
+      !excluded_move.has_value() && depth <= RAZORING_MAX_DEPTH &&
+      static_eval + RAZORING_MARGIN * depth <= alpha) {
+    auto res =
+        quiescence(alpha, alpha + 1, ply_from_root, 0, board, params, info);
+    if (!res.has_value()) {
+      return std::nullopt;
+    }
+    if (res.value().first <= alpha) {
+      return std::make_pair(alpha, std::forward_list<Move>{});
+    }
+  }
+
+  // If the position is still good enough to cause a cutoff after passing the
+  // turn to the opponent, a real move would almost certainly be even better.
+  // That can be verified much cheaper with a reduced depth search.
+  const int NULL_MOVE_MIN_DEPTH = 3;
+  const int NULL_MOVE_VERIFICATION_DEPTH = 10;
+  if (allow_null_move && ply_from_root > 0 && !in_check &&
+      depth >= NULL_MOVE_MIN_DEPTH && null_move_allowed(board) &&
+      static_eval >= beta) {
+    const int reduction = 3 + depth / 6;
+    const int null_move_depth = std::max(depth - 1 - reduction, 0);
+    stack_entry.current_move = std::nullopt;
+    board.make_null_move();
+    auto res = alpha_beta(null_move_depth, -beta, -beta + 1, ply_from_root + 1,
+                          board, params, info, extension_units, false);
+    // the searches below unwind their moves when they abort, so the null
+    // move is the last move on the board in either case
+    board.undo_null_move();
+    if (!res.has_value()) {
+      return std::nullopt;
+    }
+
+    if (-res.value().first >= beta) {
+      // at high depths, guard against zugzwang by confirming the cutoff with
+      // a reduced search where the side to move has to make a real move
+      if (depth < NULL_MOVE_VERIFICATION_DEPTH) {
+        return std::make_pair(beta, std::forward_list<Move>{});
+      }
+      auto verification =
+          alpha_beta(null_move_depth, beta - 1, beta, ply_from_root, board,
+                     params, info, extension_units, false);
+      if (!verification.has_value()) {
+        return std::nullopt;
+      }
+      if (verification.value().first >= beta) {
+        return std::make_pair(beta, std::forward_list<Move>{});
+      }
+    }
+  }
+
+  // ProbCut: if a good capture beats beta by a margin even in a much
+  // shallower search, the full depth search would very likely fail high too
+  const int PROBCUT_MIN_DEPTH = 5;
+  const int PROBCUT_REDUCTION = 4;
+  const int PROBCUT_MARGIN = 200;
+  if (ply_from_root > 0 && !is_pv_node && !in_check &&
+      !excluded_move.has_value() && depth >= PROBCUT_MIN_DEPTH &&
+      std::abs(beta) < CHECKMATE_THRESHOLD) {
+    const int probcut_beta = beta + PROBCUT_MARGIN;
+    for (const Move &move : moves) {
+      const bool is_capture = board.get_piece_type(move.end).has_value() ||
+                              move.move_type == EN_PASSANT;
+      // only captures that win enough material to reach the raised beta
+      // from the static evaluation are worth trying
+      if (!is_capture || !board.see(move, probcut_beta - static_eval)) {
+        continue;
+      }
+
+      stack_entry.current_move = move;
+      board.make(move);
+      auto res = alpha_beta(depth - PROBCUT_REDUCTION, -probcut_beta,
+                            -probcut_beta + 1, ply_from_root + 1, board,
+                            params, info, extension_units);
+      if (!res.has_value()) {
+        board.undo();
+        return std::nullopt;
+      }
+      board.undo();
+      if (-res.value().first >= probcut_beta) {
+        return std::make_pair(beta, std::forward_list<Move>{});
+      }
+    }
+  }
 
   std::optional<Move> best_move_prev_depth = std::nullopt;
   if (ply_from_root < std::distance(params.principal_variation.begin(),
@@ -149,80 +545,441 @@ alpha_beta(int depth, int alpha, int beta, int ply_from_root, Board &board,
     std::advance(move_it, ply_from_root);
     best_move_prev_depth = std::make_optional(*move_it);
   }
-  sort_moves(moves, best_move_prev_depth, info.killer_moves[ply_from_root],
-             board);
-  std::forward_list<Move> principal_variation;
-  for (const Move &move : moves) {
-    board.make(move);
-    auto res = alpha_beta(depth - 1, -beta, -alpha, ply_from_root + 1, board,
-                          params, info);
+
+  // Internal iterative reduction: without a best move from an earlier search
+  // the move ordering is poor and the full depth search expensive.
+  // Searching the node shallower is cheaper, and fills in the transposition
+  // table so the next iteration has a move to start with.
+  const int IIR_MIN_DEPTH = 4;
+  if (depth >= IIR_MIN_DEPTH && !best_move_prev_depth.has_value() &&
+      !tt_move.has_value() && !excluded_move.has_value()) {
+    depth--;
+  }
+
+  // Singular extension: if the best move from the transposition table is much
+  // better than every other move, the position is forcing and the move is
+  // worth searching deeper. If other moves would also fail high,
+  // the node can be cut off instead (multi-cut).
+  const int SINGULAR_MIN_DEPTH = 6;
+  const int SINGULAR_TT_DEPTH_MARGIN = 3;
+  bool singular_move = false;
+  if (ply_from_root > 0 && depth >= SINGULAR_MIN_DEPTH && tt_move.has_value() &&
+      tt_entry.value().bound != UPPER_BOUND &&
+      tt_entry.value().depth >= depth - SINGULAR_TT_DEPTH_MARGIN &&
+      std::abs(tt_score) < CHECKMATE_THRESHOLD &&
+      std::find(moves.begin(), moves.end(), tt_move.value()) != moves.end()) {
+    const int singular_beta = tt_score - 2 * depth;
+    stack_entry.excluded_move = tt_move;
+    auto res = alpha_beta((depth - 1) / 2, singular_beta - 1, singular_beta,
+                          ply_from_root, board, params, info, extension_units,
+                          false);
+    stack_entry.excluded_move = std::nullopt;
     if (!res.has_value()) {
       return std::nullopt;
     }
+    if (res.value().first < singular_beta) {
+      singular_move = true;
+    } else if (singular_beta >= beta) {
+      return std::make_pair(beta, std::forward_list<Move>{});
+    }
+  }
+
+  const KillerMoves &killer_moves = stack_entry.killer_moves;
+  ScoredMoves scored_moves = score_moves(
+      std::move(moves),
+      best_move_prev_depth.has_value() ? best_move_prev_depth : tt_move,
+      killer_moves, info.history, board);
+  if (ply_from_root == 0) {
+    order_root_moves(scored_moves, info.root_move_list);
+  }
+  const std::optional<Move> countermove = get_countermove(info.history, board);
+
+  // Futility pruning: at frontier (depth 1) and pre-frontier (depth 2) nodes,
+  // a quiet move can't raise a static evaluation this far below alpha
+  const std::array<int, 3> FUTILITY_MARGINS = {0, 200, 500};
+  const bool futile = ply_from_root > 0 && !in_check && !mate_bounds &&
+                      depth < FUTILITY_MARGINS.size() &&
+                      static_eval + FUTILITY_MARGINS.at(depth) <= alpha;
+
+  // Late move pruning: near the leaves, once enough quiet moves have been
+  // tried, the remaining ones are so unlikely to matter they are skipped
+  const int LATE_MOVE_PRUNING_MAX_DEPTH = 3;
+  const bool prune_late_moves = ply_from_root > 0 && !in_check &&
+                                !mate_bounds &&
+                                depth <= LATE_MOVE_PRUNING_MAX_DEPTH;
+  const int late_move_pruning_threshold =
+      improving ? 3 + depth * depth : (3 + depth * depth) / 2;
+
+  // the extensions along the path are limited to half the nominal depth
+  const int max_extension_units = params.depth * ONE_PLY / 2;
+  // none at the root and after a null move
+  const std::optional<Move> last_move =
+      ply_from_root > 0 ? info.stack.at(ply_from_root - 1).current_move
+                        : std::nullopt;
+  const bool last_move_captured = board.get_captured_piece().has_value();
+
+  std::forward_list<Move> principal_variation;
+  std::vector<Move> quiet_moves_searched;
+  std::optional<Move> best_move = std::nullopt;
+  for (int move_number = 0; move_number < scored_moves.moves.size();
+       move_number++) {
+    const Move &move = pick_move(scored_moves, move_number);
+    if (excluded_move.has_value() && move == excluded_move.value()) {
+      continue;
+    }
+    const bool is_capture = board.get_piece_type(move.end).has_value() ||
+                            move.move_type == EN_PASSANT;
+    const bool is_quiet = !is_capture && move.move_type != PROMOTION;
+    const bool is_recapture = is_capture && last_move_captured &&
+                              last_move.has_value() &&
+                              last_move.value().end == move.end;
+    if (prune_late_moves && is_quiet &&
+        move_number >= late_move_pruning_threshold) {
+      continue;
+    }
+
+    // Moves ordered late are unlikely to be the best move,
+    // so search them at a reduced depth and only search them again
+    // at full depth if they turn out to be better than expected
+    const bool late_move = depth >= LMR_MIN_DEPTH &&
+                           move_number >= LMR_MIN_MOVES && is_quiet &&
+                           !in_check;
+    int reduction = 0;
+    if (late_move) {
+      reduction = LATE_MOVE_REDUCTIONS.at(depth).at(
+          std::min(move_number, LMR_MAX_MOVES - 1));
+      // a ply less for every half of MAX_HISTORY the summed histories are
+      // above zero, a ply more for every half below, up to two plies
+      reduction -= std::clamp(get_history_score(info.history, move, board) /
+                                  (MAX_HISTORY / 2),
+                              -2, 2);
+      if (is_pv_node) {
+        reduction--;
+      }
+      if (is_killer_move(move, killer_moves) ||
+          (countermove.has_value() && move == countermove.value())) {
+        reduction--;
+      }
+    }
+
+    const long nodes_before_move = info.nodes;
+    stack_entry.current_move = move;
+    board.make(move);
+    const bool gives_check = board.is_in_check(board.get_player_to_move());
+    if (futile && is_quiet && move_number > 0 && !gives_check) {
+      board.undo();
+      continue;
+    }
+
+    // Spend more depth on tactical moves. The fractions of a ply add up along
+    // the path and the depth is extended whenever they make up a full ply.
+    const int singular_extension =
+        singular_move && move == tt_move.value() ? ONE_PLY : 0;
+    const int child_extension_units =
+        std::min(extension_units + singular_extension +
+                     extension(gives_check, is_recapture, board),
+                 max_extension_units);
+    int extended_plies =
+        child_extension_units / ONE_PLY - extension_units / ONE_PLY;
+    if (ply_from_root + depth + extended_plies > MAX_DEPTH) {
+      extended_plies = 0;
+    }
+    const int new_depth = depth - 1 + extended_plies;
+
+    if (late_move) {
+      if (gives_check) {
+        reduction--;
+      }
+      reduction = std::clamp(reduction, 0, new_depth - 1);
+    }
+
+    std::optional<std::pair<int, std::forward_list<Move>>> res = std::nullopt;
+    if (reduction > 0) {
+      res = alpha_beta(new_depth - reduction, -alpha - 1, -alpha,
+                       ply_from_root + 1, board, params, info,
+                       child_extension_units);
+      if (!res.has_value()) {
+        board.undo();
+        return std::nullopt;
+      }
+    }
+    if (reduction == 0 || -res.value().first > alpha) {
+      res = alpha_beta(new_depth, -beta, -alpha, ply_from_root + 1, board,
+                       params, info, child_extension_units);
+      if (!res.has_value()) {
+        board.undo();
+        return std::nullopt;
+      }
+    }
     const int evaluation = -res.value().first;
     std::forward_list<Move> variation = res.value().second;
     variation.push_front(move);
     board.undo();
+    if (ply_from_root == 0) {
+      // a move that fails low gets alpha as its score, which is no better
+      // than the score of the best move so far
+      update_root_move(info.root_move_list, move,
+                       evaluation > alpha ? evaluation : -CHECKMATE,
+                       info.nodes - nodes_before_move);
+    }
 
     // the move is too good so the opponent will not enter this variation
     if (evaluation >= beta) {
       // because the move was so good, try to refute the opponents other
       // moves with it as well
-      info.killer_moves[ply_from_root].insert(move);
+      if (is_quiet) {
+        store_killer_move(stack_entry.killer_moves, move);
+        store_countermove(info.history, move, board);
+
+        // reward the move and punish the quiet moves that were tried before
+        // it but failed to produce a cutoff
+        const int bonus = history_bonus(depth);
+        update_history(info.history, move, board, bonus);
+        for (const Move &quiet_move : quiet_moves_searched) {
+          update_history(info.history, quiet_move, board, -bonus);
+        }
+      }
+      if (store_in_tt) {
+        info.tt.store({
+            .key = board.get_zobrist_key(),
+            .depth = depth,
+            .score = score_to_tt(beta, ply_from_root),
+            .bound = LOWER_BOUND,
+            .best_move = move,
+            .static_eval = static_eval,
+        });
+      }
       return std::make_pair(beta, variation);
     }
+    if (is_quiet) {
+      quiet_moves_searched.push_back(move);
+    }
 
     // the move is the best so far
     if (evaluation > alpha) {
       alpha = evaluation;
       principal_variation = variation;
+      best_move = move;
     }
   }
+
+  if (store_in_tt) {
+    info.tt.store({
+        .key = board.get_zobrist_key(),
+        .depth = depth,
+        .score = score_to_tt(alpha, ply_from_root),
+        .bound = best_move.has_value() ? EXACT : UPPER_BOUND,
+        .best_move = best_move,
+        .static_eval = static_eval,
+    });
+  }
   return std::make_pair(alpha, principal_variation);
 }
 
-std::vector<SearchSummary> iterative_deepening_search(Board &board, int depth,
-                                                      int allocated_time,
-                                                      std::atomic<bool> &stop) {
+std::vector<SearchSummary>
+iterative_deepening_search(Board &board, History &history,
+                           TranspositionTable &tt, const SearchLimits &limits,
+                           std::atomic<bool> &stop, std::atomic<bool> &ponder) {
   const auto start_time = std::chrono::high_resolution_clock::now();
+  tt.new_search();
   SearchInfo info = {
       .seldepth = 0,
       .nodes = 0,
-      .killer_moves = {},
+      .calls_since_time_check = 0,
+      .out_of_time = false,
+      .move_start_time = start_time,
+      .stack = {},
+      .root_move_list = {},
+      .history = history,
+      .tt = tt,
   };
-  std::forward_list<Move> principal_variation = {};
+  const std::vector<Move> root_moves = limits.search_moves.empty()
+                                           ? board.get_legal_moves()
+                                           : limits.search_moves;
+  const int nr_lines = std::min(limits.multi_pv, (int)root_moves.size());
+  // the first iteration has nothing better to go on than the usual ordering
+  std::vector<Move> ordered_root_moves = root_moves;
+  sort_moves(ordered_root_moves, std::nullopt, KillerMoves{}, info.history,
+             board);
+  for (int rank = 0; rank < ordered_root_moves.size(); rank++) {
+    info.root_move_list.push_back({.move = ordered_root_moves.at(rank),
+                                   .score = -CHECKMATE,
+                                   .nodes = 0,
+                                   .previous_rank = rank});
+  }
+  std::vector<std::forward_list<Move>> principal_variations(nr_lines);
   std::vector<SearchSummary> search_summaries;
-  for (int current_depth = 1; current_depth <= depth; current_depth++) {
-    SearchParams params = {
-        .depth = current_depth,
-        .principal_variation = principal_variation,
-        .allocated_time = allocated_time,
-        .start_time = start_time,
-        .stop = stop,
-    };
-    // initialize alpha and beta to the value of immediate checkmate
-    // so any legal move will be considered better
-    const auto res = alpha_beta(current_depth, -CHECKMATE, CHECKMATE, 0, board,
-                                params, info);
-    if (!res.has_value()) {
+  bool search_aborted = false;
+  for (int current_depth = 1; current_depth <= limits.depth; current_depth++) {
+    // keep the ordering learned in earlier iterations and searches but let
+    // the cutoffs found at the new depth dominate
+    age_history(info.history);
+    const long nodes_before_iteration = info.nodes;
+    for (RootMove &root_move : info.root_move_list) {
+      root_move.nodes = 0;
+    }
+
+    // Each line is the best line among the root moves that don't start one
+    // of the better lines. The lines after the first one are cheaper to
+    // search because the transposition table has been filled by the
+    // lines before them.
+    std::vector<Move> remaining_moves = root_moves;
+    std::vector<SearchSummary> lines;
+    for (int line = 0; line < nr_lines; line++) {
+      SearchParams params = {
+          .depth = current_depth,
+          .principal_variation = principal_variations.at(line),
+          .allocated_time = limits.allocated_time,
+          .stop = stop,
+          .ponder = ponder,
+          .root_moves = line == 0 && limits.search_moves.empty()
+                            ? std::vector<Move>{}
+                            : remaining_moves,
+          .max_nodes = limits.max_nodes,
+      };
+      // initialize alpha and beta to the value of immediate checkmate
+      // so any legal move will be considered better
+      const auto res = alpha_beta(current_depth, -CHECKMATE, CHECKMATE, 0,
+                                  board, params, info, 0);
+      if (!res.has_value()) {
+        search_aborted = true;
+        break;
+      }
+
+      const std::forward_list<Move> &principal_variation = res.value().second;
+      std::erase(remaining_moves, principal_variation.front());
+      lines.push_back({
+          .depth = current_depth,
+          .seldepth = info.seldepth,
+          .multipv = line + 1,
+          .score = res.value().first,
+          .nodes = info.nodes,
+          .time = time_elapsed(start_time),
+          .pv = principal_variation,
+      });
+    }
+    if (search_aborted) {
       break;
     }
 
-    const int evaluation = res.value().first;
-    principal_variation = res.value().second;
-    SearchSummary search_summary = {.depth = current_depth,
-                                    .seldepth = info.seldepth,
-                                    .score = evaluation,
-                                    .nodes = info.nodes,
-                                    .time = time_elapsed(start_time),
-                                    .pv = principal_variation};
-    fmt::println("{}", uci::show(search_summary));
+    // a later line can score better than an earlier one because the moves
+    // of the earlier lines are no longer searched along with it
+    std::stable_sort(lines.begin(), lines.end(),
+                     [](const SearchSummary &a, const SearchSummary &b) {
+                       if (a.score != b.score) {
+                         return a.score > b.score;
+                       }
+                       return a.nodes > b.nodes;
+                     });
+    for (int line = 0; line < nr_lines; line++) {
+      SearchSummary &search_summary = lines.at(line);
+      search_summary.multipv = line + 1;
+      search_summary.nodes = info.nodes;
+      search_summary.time = time_elapsed(start_time);
+      principal_variations.at(line) = search_summary.pv;
+      fmt::println("{}", uci::show(search_summary));
+      search_summaries.push_back(search_summary);
+    }
     std::flush(std::cout);
-    search_summaries.push_back(search_summary);
+
+    // The best moves of the lines are searched first in the next iteration.
+    // The other moves follow by exact score and then by the effort it took
+    // to refute them, as the moves that were hardest to refute are the most
+    // likely to become the best move. Moves that are still tied keep
+    // their previous rank.
+    auto line_rank = [&](const RootMove &root_move) {
+      auto it = std::find_if(principal_variations.begin(),
+                             principal_variations.end(),
+                             [&](const std::forward_list<Move> &pv) {
+                               return pv.front() == root_move.move;
+                             });
+      return std::distance(principal_variations.begin(), it);
+    };
+    std::stable_sort(info.root_move_list.begin(), info.root_move_list.end(),
+                     [&](const RootMove &a, const RootMove &b) {
+                       if (line_rank(a) != line_rank(b)) {
+                         return line_rank(a) < line_rank(b);
+                       }
+                       if (a.score != b.score) {
+                         return a.score > b.score;
+                       }
+                       return a.nodes > b.nodes;
+                     });
+    const RootMove &best_root_move = info.root_move_list.front();
+    const bool best_move_changed = best_root_move.previous_rank != 0;
+    const double best_move_nodes_share =
+        (double)best_root_move.nodes /
+        std::max(info.nodes - nodes_before_iteration, 1L);
+    for (int rank = 0; rank < info.root_move_list.size(); rank++) {
+      info.root_move_list.at(rank).previous_rank = rank;
+    }
+
+    if (limits.flexible_time && !ponder && !best_move_changed &&
+        can_stop_early(time_elapsed(info.move_start_time),
+                       limits.allocated_time, best_move_nodes_share)) {
+      break;
+    }
   }
+  assert(!principal_variations.empty());
+  send_bestmove(principal_variations.front(), stop, ponder);
+  return search_summaries;
+}
+
+void send_bestmove(const std::forward_list<Move> &principal_variation,
+                   const std::atomic<bool> &stop,
+                   const std::atomic<bool> &ponder) {
+  // while pondering, the best move may only be sent after ponderhit or stop
+  while (ponder && !stop) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
   assert(!principal_variation.empty());
-  fmt::println("{}", uci::bestmove(principal_variation.front()));
+  // the expected reply is the move to ponder on
+  const std::optional<Move> ponder_move =
+      std::next(principal_variation.begin()) != principal_variation.end()
+          ? std::make_optional(*std::next(principal_variation.begin()))
+          : std::nullopt;
+  fmt::println("{}", uci::bestmove(principal_variation.front(), ponder_move));
   std::flush(std::cout);
-  return search_summaries;
+}
+
+int shallow_search(Board &board, int depth, History &history,
+                   TranspositionTable &tt) {
+  // a shallow search always completes, nothing needs to stop it
+  const std::atomic<bool> stop = false;
+  const std::atomic<bool> ponder = false;
+  SearchInfo info = {
+      .seldepth = 0,
+      .nodes = 0,
+      .calls_since_time_check = 0,
+      .out_of_time = false,
+      .move_start_time = std::chrono::high_resolution_clock::now(),
+      .stack = {},
+      .root_move_list = {},
+      .history = history,
+      .tt = tt,
+  };
+  // with no earlier iteration the root moves keep the usual ordering
+  std::vector<Move> ordered_root_moves = board.get_legal_moves();
+  sort_moves(ordered_root_moves, std::nullopt, KillerMoves{}, info.history,
+             board);
+  for (int rank = 0; rank < ordered_root_moves.size(); rank++) {
+    info.root_move_list.push_back({.move = ordered_root_moves.at(rank),
+                                   .score = -CHECKMATE,
+                                   .nodes = 0,
+                                   .previous_rank = rank});
+  }
+  const SearchParams params = {
+      .depth = depth,
+      .principal_variation = {},
+      .allocated_time = std::numeric_limits<int>::max(),
+      .stop = stop,
+      .ponder = ponder,
+      .root_moves = {},
+      .max_nodes = std::nullopt,
+  };
+  return alpha_beta(depth, -CHECKMATE, CHECKMATE, 0, board, params, info, 0)
+      .value()
+      .first;
 }
 } // namespace search
@@ -3,25 +3,85 @@
 #include <atomic>
 #include <chrono>
 #include <forward_list>
-#include <map>
-#include <unordered_set>
 
 #include "board/board.hpp"
+#include "engine/history.hpp"
+#include "engine/move_sort.hpp"
+#include "engine/transposition_table.hpp"
 #include "move.hpp"
 #include "uci.hpp"
 
+const int MAX_DEPTH = 100;
+// hard limit on the distance from the root, including quiescence search
+const int MAX_PLY = 128;
+
+// what the search knows about a ply of the current path
+struct SearchStackEntry {
+  // none when in check
+  std::optional<int> static_eval;
+  // the move being searched, none for a null move. The child nodes read it
+  // to recognise recaptures.
+  std::optional<Move> current_move;
+  KillerMoves killer_moves;
+  // move to leave out of the search of the position, used for singular
+  // extensions
+  std::optional<Move> excluded_move;
+};
+
+// number of search calls between reads of the clock
+const int TIME_CHECK_INTERVAL = 2048;
+
+// what the earlier iterations found out about a root move
+struct RootMove {
+  Move move;
+  // -CHECKMATE when the move failed low, as the score is only an upper bound
+  // then
+  int score;
+  // nodes spent on the move in the last iteration
+  long nodes;
+  // position in the root move list before the last iteration
+  int previous_rank;
+};
+
 struct SearchInfo {
   int seldepth;
   long nodes;
-  std::map<int, std::unordered_set<Move, Move::HashFunction>> killer_moves;
+  int calls_since_time_check;
+  bool out_of_time;
+  // when the time allocated for the move started running
+  std::chrono::time_point<std::chrono::high_resolution_clock> move_start_time;
+  std::array<SearchStackEntry, MAX_PLY> stack;
+  // the root moves in the order to search them
+  std::vector<RootMove> root_move_list;
+  History &history;
+  TranspositionTable &tt;
 };
 
 struct SearchParams {
   int depth;
   std::forward_list<Move> principal_variation;
   int allocated_time;
-  std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
   const std::atomic<bool> &stop;
+  // searching on the opponent's time, the clock doesn't run until ponderhit
+  const std::atomic<bool> &ponder;
+  // the moves to search at the root, all legal moves if empty
+  std::vector<Move> root_moves;
+  std::optional<long> max_nodes;
+};
+
+// what the search was asked to do
+struct SearchLimits {
+  int depth;
+  // in milliseconds
+  int allocated_time;
+  int multi_pv;
+  // the root moves to choose from, all legal moves if empty
+  std::vector<Move> search_moves;
+  // Stopping after a number of nodes instead of after some time makes the
+  // search independent of the speed of the machine
+  std::optional<long> max_nodes;
+  // the search may stop before the allocated time has run out
+  bool flexible_time;
 };
 
 const int DRAW = 0;
@@ -29,7 +89,16 @@ const int CHECKMATE = 50000;
 const int CHECKMATE_THRESHOLD = 49000;
 
 namespace search {
-std::vector<SearchSummary> iterative_deepening_search(Board &board, int depth,
-                                                      int allocated_time,
-                                                      std::atomic<bool> &stop);
+std::vector<SearchSummary>
+iterative_deepening_search(Board &board, History &history,
+                           TranspositionTable &tt, const SearchLimits &limits,
+                           std::atomic<bool> &stop, std::atomic<bool> &ponder);
+// sends the first move of the principal variation as the best move, once
+// pondering is over
+void send_bestmove(const std::forward_list<Move> &principal_variation,
+                   const std::atomic<bool> &stop,
+                   const std::atomic<bool> &ponder);
+// score of a fixed-depth search for the player to move, without output
+int shallow_search(Board &board, int depth, History &history,
+                   TranspositionTable &tt);
 };
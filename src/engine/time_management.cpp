@@ -8,3 +8,17 @@ int calc_allocated_time(Color player_to_move, int white_remaining_time,
 
   return allocated_time == 0 ? 1 : allocated_time;
 }
+
+// Another iteration is unlikely to finish in the remaining time, or to
+// change the best move if the search already spent most of its effort on it
+bool can_stop_early(int time_elapsed, int allocated_time,
+                    double best_move_nodes_share) {
+  return time_elapsed > allocated_time * (1 - best_move_nodes_share / 2);
+}
+
+int time_elapsed(
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_time) {
+  auto now = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time)
+      .count();
+}
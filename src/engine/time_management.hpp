@@ -1,6 +1,13 @@
 #pragma once
 
+#include <chrono>
+
 #include "defs.hpp"
 
 int calc_allocated_time(Color player_to_move, int white_remaining_time,
                         int black_remaining_time);
+bool can_stop_early(int time_elapsed, int allocated_time,
+                    double best_move_nodes_share);
+// in milliseconds
+int time_elapsed(
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_time);
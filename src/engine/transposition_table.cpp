@@ -0,0 +1,81 @@
+#include "transposition_table.hpp"
+
+#include <algorithm>
+
+#include "engine/search.hpp"
+
+TranspositionTable::TranspositionTable(int size_mb) {
+  const size_t nr_buckets = (size_t)size_mb * 1024 * 1024 / sizeof(Bucket);
+  buckets = std::vector<Bucket>(nr_buckets);
+}
+
+std::optional<TTEntry> TranspositionTable::probe(uint64_t key) const {
+  const Bucket &bucket = buckets.at(key % buckets.size());
+  for (const std::optional<TTEntry> &entry :
+       {bucket.depth_preferred, bucket.always_replace}) {
+    if (entry.has_value() && entry.value().key == key) {
+      return entry;
+    }
+  }
+  return std::nullopt;
+}
+
+// keep what the new entry doesn't know from the old entry of the position
+static TTEntry merge_entries(const TTEntry &new_entry,
+                             const std::optional<TTEntry> &old_entry) {
+  TTEntry entry = new_entry;
+  if (old_entry.has_value() && old_entry.value().key == new_entry.key) {
+    if (!entry.best_move.has_value()) {
+      entry.best_move = old_entry.value().best_move;
+    }
+    if (!entry.static_eval.has_value()) {
+      entry.static_eval = old_entry.value().static_eval;
+    }
+  }
+  return entry;
+}
+
+void TranspositionTable::store(const TTEntry &entry) {
+  Bucket &bucket = buckets.at(entry.key % buckets.size());
+  const std::optional<TTEntry> &deepest = bucket.depth_preferred;
+  if (!deepest.has_value() || bucket.generation != generation ||
+      entry.depth >= deepest.value().depth) {
+    // the replaced entry is still worth more than the always replace entry
+    if (deepest.has_value() && deepest.value().key != entry.key) {
+      bucket.always_replace = deepest;
+    }
+    bucket.depth_preferred = merge_entries(entry, deepest);
+    bucket.generation = generation;
+    return;
+  }
+  bucket.always_replace = merge_entries(entry, bucket.always_replace);
+}
+
+void TranspositionTable::clear() {
+  std::fill(buckets.begin(), buckets.end(), Bucket{});
+  generation = 0;
+}
+
+void TranspositionTable::new_search() { generation++; }
+
+// Mate scores are relative to the root, but a position can be reached at
+// different plies, so they are stored relative to the position itself
+int score_to_tt(int score, int ply_from_root) {
+  if (score > CHECKMATE_THRESHOLD) {
+    return score + ply_from_root;
+  }
+  if (score < -CHECKMATE_THRESHOLD) {
+    return score - ply_from_root;
+  }
+  return score;
+}
+
+int score_from_tt(int score, int ply_from_root) {
+  if (score > CHECKMATE_THRESHOLD) {
+    return score - ply_from_root;
+  }
+  if (score < -CHECKMATE_THRESHOLD) {
+    return score + ply_from_root;
+  }
+  return score;
+}
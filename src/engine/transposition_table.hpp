@@ -0,0 +1,53 @@
+#pragma once
+
+#include <optional>
+#include <stdint.h>
+#include <vector>
+
+#include "move.hpp"
+
+const int DEFAULT_HASH_SIZE_MB = 64;
+
+// what the stored score says about the real score of the position
+enum Bound { EXACT, LOWER_BOUND, UPPER_BOUND };
+
+struct TTEntry {
+  uint64_t key;
+  int depth;
+  int score;
+  Bound bound;
+  std::optional<Move> best_move;
+  // saves evaluating the position again
+  std::optional<int> static_eval;
+};
+
+// Remembers the results of searched positions so that transpositions,
+// and the same positions in later iterations, don't have to be searched again
+class TranspositionTable {
+public:
+  TranspositionTable(int size_mb);
+
+  std::optional<TTEntry> probe(uint64_t key) const;
+  void store(const TTEntry &entry);
+  void clear();
+  // entries from earlier searches are replaced more easily
+  void new_search();
+
+private:
+  // Every position maps to a bucket of two entries. One keeps the deepest
+  // search of the current search so the expensive results survive, the
+  // other always takes the newest entry so shallow results such as those
+  // of the quiescence search can still be stored.
+  struct Bucket {
+    std::optional<TTEntry> depth_preferred;
+    // the search the depth preferred entry was stored in
+    int generation;
+    std::optional<TTEntry> always_replace;
+  };
+
+  std::vector<Bucket> buckets;
+  int generation = 0;
+};
+
+int score_to_tt(int score, int ply_from_root);
+int score_from_tt(int score, int ply_from_root);
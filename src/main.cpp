@@ -2,24 +2,41 @@
 #include <atomic>
 #include <condition_variable>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
 
 #include "engine/command.hpp"
 #include "engine/engine.hpp"
+#include "engine/history.hpp"
+#include "engine/mcts.hpp"
+#include "engine/transposition_table.hpp"
 #include "uci.hpp"
 
 void read_input(std::queue<Command> &commands, std::condition_variable &cv,
-                std::mutex &mtx, std::atomic<bool> &stop) {
+                std::mutex &mtx, std::atomic<bool> &stop,
+                std::atomic<bool> &ponder) {
   std::string input;
   while (std::getline(std::cin, input)) {
     if (input == "stop") {
+      ponder = false;
       stop = true;
       continue;
     }
+    // the opponent made the expected move, so the search continues but
+    // now on the engine's own clock
+    if (input == "ponderhit") {
+      ponder = false;
+      continue;
+    }
 
     Command cmd = uci::process(input);
+    // set here rather than when the search starts so that a ponderhit
+    // that arrives before then isn't lost
+    if (cmd.ponder) {
+      ponder = true;
+    }
     {
       std::lock_guard<std::mutex> lock(mtx);
       commands.push(cmd);
@@ -39,8 +56,15 @@ void read_input(std::queue<Command> &commands, std::condition_variable &cv,
 }
 
 void run_engine(std::queue<Command> &commands, std::condition_variable &cv,
-                std::mutex &mtx, std::atomic<bool> &stop) {
+                std::mutex &mtx, std::atomic<bool> &stop,
+                std::atomic<bool> &ponder) {
   Board board = Board::get_starting_position();
+  History history = {};
+  TranspositionTable tt(DEFAULT_HASH_SIZE_MB);
+  Options options = {
+      .multi_pv = 1, .search_algorithm = ALPHA_BETA, .mcts_threads = 1};
+  // allocated when the Monte-Carlo tree search is selected
+  std::unique_ptr<mcts::SearchMemory> mcts_memory;
   while (true) {
     Command cmd;
     {
@@ -54,7 +78,8 @@ void run_engine(std::queue<Command> &commands, std::condition_variable &cv,
       return;
     }
     stop = false;
-    engine::execute_command(cmd, stop, board);
+    engine::execute_command(cmd, stop, ponder, board, history, tt, options,
+                            mcts_memory);
   }
 }
 
@@ -63,11 +88,12 @@ int main() {
   std::condition_variable cv;
   std::mutex mtx;
   std::atomic<bool> stop = false;
+  std::atomic<bool> ponder = false;
 
   std::thread t1(read_input, std::ref(commands), std::ref(cv), std::ref(mtx),
-                 std::ref(stop));
+                 std::ref(stop), std::ref(ponder));
   std::thread t2(run_engine, std::ref(commands), std::ref(cv), std::ref(mtx),
-                 std::ref(stop));
+                 std::ref(stop), std::ref(ponder));
 
   t1.join();
   t2.join();
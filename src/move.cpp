@@ -40,6 +40,6 @@ std::string Move::to_uci_notation() const {
 
 size_t Move::HashFunction::operator()(const Move &move) const {
   size_t start_hash = std::hash<int>()(move.start);
-  size_t end_hash = std::hash<int>()(move.start) << 1;
+  size_t end_hash = std::hash<int>()(move.end) << 1;
   return start_hash ^ end_hash;
 }
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <fmt/core.h>
 #include <numeric>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -38,6 +39,24 @@ get_position_moves(const std::vector<std::string> &words) {
   return std::vector<std::string>(moves_it + 1, words.end());
 }
 
+// Removes "searchmoves <move1> ... <movei>" from the words of a go command
+// and returns the moves
+std::vector<std::string> get_search_moves(std::vector<std::string> &words) {
+  const std::vector<std::string> GO_PARAMETERS = {
+      "wtime", "btime",    "winc",  "binc",     "movestogo", "depth",
+      "nodes", "movetime", "mate",  "infinite", "perft",     "ponder"};
+  auto search_moves_it = std::find(words.begin(), words.end(), "searchmoves");
+  if (search_moves_it == words.end()) {
+    return {};
+  }
+  auto moves_end_it =
+      std::find_first_of(search_moves_it + 1, words.end(),
+                         GO_PARAMETERS.begin(), GO_PARAMETERS.end());
+  const std::vector<std::string> moves(search_moves_it + 1, moves_end_it);
+  words.erase(search_moves_it, moves_end_it);
+  return moves;
+}
+
 Command get_go_command(const std::vector<std::string> &words) {
   if (words.size() < 3) {
     return Command::go_infinite();
@@ -57,6 +76,13 @@ Command get_go_command(const std::vector<std::string> &words) {
     int depth = std::stoi(value);
     return Command::go_perft(depth);
   }
+  if (name == "nodes") {
+    const long nodes = std::stoll(value);
+    if (nodes <= 0) {
+      throw std::out_of_range("the node limit has to be positive");
+    }
+    return Command::go_nodes(nodes);
+  }
 
   int wtime = 0;
   int btime = 0;
@@ -85,6 +111,21 @@ Command get_go_command(const std::vector<std::string> &words) {
   return Command::go_infinite();
 }
 
+// setoption name <name> value <value>, where the name can contain spaces
+Command get_set_option_command(const std::vector<std::string> &words) {
+  auto join = [](std::string str1, std::string str2) {
+    return str1.empty() ? str2 : fmt::format("{} {}", str1, str2);
+  };
+  auto value_it = std::find(words.begin(), words.end(), "value");
+  const std::string name =
+      std::accumulate(words.begin() + 2, value_it, std::string(""), join);
+  const std::string value =
+      value_it == words.end()
+          ? ""
+          : std::accumulate(value_it + 1, words.end(), std::string(""), join);
+  return Command::set_option(name, value);
+}
+
 Command process(const std::string &input) {
   const std::vector<std::string> words = str_split(input, ' ');
 
@@ -92,12 +133,32 @@ Command process(const std::string &input) {
     return Command::uci();
   } else if (input == "isready") {
     return Command::is_ready();
+  } else if (input == "ucinewgame") {
+    return Command::new_game();
   } else if (!words.empty() && words.at(0) == "position") {
     const std::string fen = get_position_fen(words);
     const std::vector<std::string> moves = get_position_moves(words);
     return Command::update_board(fen, moves);
   } else if (!words.empty() && words.at(0) == "go") {
-    return get_go_command(words);
+    // pondering doesn't change what to search, only when the clock runs
+    std::vector<std::string> go_words = words;
+    const bool ponder = std::erase(go_words, "ponder") > 0;
+    const std::vector<std::string> search_moves =
+        get_search_moves(go_words);
+    Command command;
+    try {
+      command = get_go_command(go_words);
+    } catch (const std::logic_error &e) {
+      // std::stoi and std::stoll throw std::invalid_argument for values that
+      // aren't numbers and std::out_of_range for numbers that don't fit
+      return Command::invalid(input);
+    }
+    command.ponder = ponder;
+    command.search_moves = search_moves;
+    return command;
+  } else if (words.size() >= 3 && words.at(0) == "setoption" &&
+             words.at(1) == "name") {
+    return get_set_option_command(words);
   } else if (input == "quit") {
     return Command::quit();
   } else {
@@ -112,6 +173,11 @@ std::string show(const SearchSummary &ss) {
   const std::string score = std::abs(ss.score) > CHECKMATE_THRESHOLD
                                 ? fmt::format("mate {}", sign * mate_in_x)
                                 : fmt::format("cp {}", ss.score);
+  const std::string wdl =
+      ss.wdl.has_value() ? fmt::format(" wdl {} {} {}", ss.wdl.value().at(0),
+                                       ss.wdl.value().at(1),
+                                       ss.wdl.value().at(2))
+                         : "";
 
   const long long nps = ss.nodes * 1000 / (ss.time == 0 ? 1 : ss.time);
   const std::string pv =
@@ -120,12 +186,18 @@ std::string show(const SearchSummary &ss) {
                         return fmt::format("{} {}", acc, m.to_uci_notation());
                       });
 
-  return fmt::format("info depth {} seldepth {} multipv 1 score {} nodes {} "
-                     "nps {} time {} pv{}",
-                     ss.depth, ss.seldepth, score, ss.nodes, nps, ss.time, pv);
+  return fmt::format("info depth {} seldepth {} multipv {} score {}{} nodes "
+                     "{} nps {} time {} pv{}",
+                     ss.depth, ss.seldepth, ss.multipv, score, wdl, ss.nodes,
+                     nps, ss.time, pv);
 }
 
-std::string bestmove(const Move &move) {
+std::string bestmove(const Move &move,
+                     const std::optional<Move> &ponder_move) {
+  if (ponder_move.has_value()) {
+    return fmt::format("bestmove {} ponder {}\n", move.to_uci_notation(),
+                       ponder_move.value().to_uci_notation());
+  }
   return fmt::format("bestmove {}\n", move.to_uci_notation());
 }
 } // namespace uci
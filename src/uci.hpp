@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <forward_list>
+#include <optional>
 #include <string>
 
 #include "engine/command.hpp"
@@ -9,14 +11,17 @@
 struct SearchSummary {
   int depth;
   int seldepth;
+  int multipv;
   int score;
   long long nodes;
   long long time;
   std::forward_list<Move> pv;
+  // chances of a win, draw and loss in thousandths, when the search has them
+  std::optional<std::array<int, 3>> wdl;
 };
 
 namespace uci {
 Command process(const std::string &input);
 std::string show(const SearchSummary &search_summary);
-std::string bestmove(const Move &move);
+std::string bestmove(const Move &move, const std::optional<Move> &ponder_move);
 }; // namespace uci
@@ -1,4 +1,5 @@
 #include "board/board.hpp"
+#include "evaluation/evaluation.hpp"
 #include "fen.hpp"
 #include <gtest/gtest.h>
 
@@ -16,3 +17,91 @@ TEST(Board, get_doubled_pawns) {
   EXPECT_EQ(b.get_doubled_pawns(WHITE), 1);
   EXPECT_EQ(b.get_doubled_pawns(BLACK), 1);
 }
+
+TEST(Board, get_moved_piece) {
+  Board b = Board::get_starting_position();
+  EXPECT_EQ(b.get_moved_piece(1), std::nullopt);
+
+  b.make(Move(e2, e4, PAWN_TWO_SQUARES_FORWARD));
+  b.make(Move(g8, f6));
+  EXPECT_EQ(b.get_moved_piece(1), Piece(KNIGHT, BLACK, f6));
+  EXPECT_EQ(b.get_moved_piece(2), Piece(PAWN, WHITE, e4));
+  EXPECT_EQ(b.get_moved_piece(3), std::nullopt);
+
+  b.undo();
+  EXPECT_EQ(b.get_moved_piece(1), Piece(PAWN, WHITE, e4));
+}
+
+TEST(Board, null_move) {
+  Board b = fen::get_position(
+      "rnbqkbnr/ppp1pppp/8/8/3pP3/5N2/PPPP1PPP/RNBQKB1R b KQkq e3 0 3");
+  b.make_null_move();
+  EXPECT_EQ(b.get_player_to_move(), WHITE);
+  EXPECT_EQ(b.get_en_passant_square(), std::nullopt);
+  EXPECT_EQ(b.get_moved_piece(1), std::nullopt);
+
+  b.undo_null_move();
+  EXPECT_EQ(b.get_player_to_move(), BLACK);
+  EXPECT_EQ(b.get_en_passant_square(), e3);
+}
+
+TEST(Board, get_non_pawn_material) {
+  Board b = fen::get_position("8/5pk1/8/8/8/8/3PP3/1N2K3 w - - 0 1");
+  EXPECT_EQ(b.get_non_pawn_material(WHITE), KNIGHT_VALUE);
+  EXPECT_EQ(b.get_non_pawn_material(BLACK), 0);
+}
+
+TEST(Board, has_pawns_about_to_promote) {
+  Board b = fen::get_position("8/1P3pk1/8/8/8/8/4p3/4K3 w - - 0 1");
+  EXPECT_TRUE(b.has_pawns_about_to_promote(WHITE));
+  EXPECT_TRUE(b.has_pawns_about_to_promote(BLACK));
+
+  b = Board::get_starting_position();
+  EXPECT_FALSE(b.has_pawns_about_to_promote(WHITE));
+  EXPECT_FALSE(b.has_pawns_about_to_promote(BLACK));
+}
+
+TEST(Board, zobrist_key_matches_fen) {
+  Board b = Board::get_starting_position();
+  const uint64_t starting_key = b.get_zobrist_key();
+  b.make(Move(e2, e4, PAWN_TWO_SQUARES_FORWARD));
+  EXPECT_EQ(b.get_zobrist_key(),
+            fen::get_position("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b "
+                              "KQkq e3 0 1")
+                .get_zobrist_key());
+  b.undo();
+  EXPECT_EQ(b.get_zobrist_key(), starting_key);
+
+  b = fen::get_position("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+  b.make(Move(e1, g1, CASTLING));
+  Board castled = fen::get_position("r3k2r/8/8/8/8/8/8/R4RK1 b kq - 1 1");
+  EXPECT_EQ(b.get_zobrist_key(), castled.get_zobrist_key());
+
+  b = fen::get_position("1n2k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+  b.make(Move(a7, b8, QUEEN));
+  Board promoted = fen::get_position("1Q2k3/8/8/8/8/8/8/4K3 b - - 0 1");
+  EXPECT_EQ(b.get_zobrist_key(), promoted.get_zobrist_key());
+
+  b = fen::get_position("4k3/8/8/3Pp3/8/8/8/4K3 w - e6 0 1");
+  b.make(Move(d5, e6, EN_PASSANT));
+  Board captured = fen::get_position("4k3/8/4P3/8/8/8/8/4K3 b - - 0 1");
+  EXPECT_EQ(b.get_zobrist_key(), captured.get_zobrist_key());
+}
+
+TEST(Board, zobrist_key_transposition) {
+  Board board1 = Board::get_starting_position();
+  board1.make(Move(g1, f3));
+  board1.make(Move(g8, f6));
+  board1.make(Move(b1, c3));
+
+  Board board2 = Board::get_starting_position();
+  board2.make(Move(b1, c3));
+  board2.make(Move(g8, f6));
+  board2.make(Move(g1, f3));
+  EXPECT_EQ(board1.get_zobrist_key(), board2.get_zobrist_key());
+
+  board2.make_null_move();
+  EXPECT_NE(board1.get_zobrist_key(), board2.get_zobrist_key());
+  board2.undo_null_move();
+  EXPECT_EQ(board1.get_zobrist_key(), board2.get_zobrist_key());
+}
@@ -1,4 +1,5 @@
 #include "board/board.hpp"
+#include "board/zobrist.hpp"
 #include "fen.hpp"
 #include "fmt/core.h"
 #include <gtest/gtest.h>
@@ -132,3 +133,65 @@ TEST(DrawTests, TestNotThreefoldRepetitionIfPositionOccursTwice) {
   }
   EXPECT_FALSE(b.is_threefold_repetition());
 }
+
+TEST(DrawTests, TestRepetitionAfterRoot) {
+  Board b = fen::get_position("5k2/8/6r1/8/3Q4/8/4K3/8 w - - 0 1");
+
+  std::vector<Move> moves = {
+      Move(d4, d8),
+      Move(f8, g7),
+      Move(d8, d4),
+      Move(g7, f8),
+  };
+  for (Move m : moves) {
+    b.make(m);
+  }
+  // the position occurs twice, which is only a draw in the search when the
+  // first time was after the root
+  EXPECT_FALSE(b.is_repetition(0));
+  EXPECT_FALSE(b.is_repetition(4));
+  EXPECT_TRUE(b.is_repetition(5));
+  for (Move m : moves) {
+    b.make(m);
+  }
+  EXPECT_TRUE(b.is_repetition(0));
+}
+
+TEST(DrawTests, CuckooTableHasAllReversibleMoves) {
+  const CuckooTable &table = get_cuckoo_table();
+  const long nr_moves =
+      std::count_if(table.moves.begin(), table.moves.end(),
+                    [](const std::optional<Move> &m) { return m.has_value(); });
+  EXPECT_EQ(nr_moves, 3668);
+  EXPECT_EQ(cuckoo_lookup(0), std::nullopt);
+}
+
+TEST(DrawTests, TestUpcomingRepetition) {
+  Board b = Board::get_starting_position();
+  b.make(Move(g1, f3));
+  b.make(Move(g8, f6));
+  b.make(Move(f3, g1));
+  // Nf6-g8 repeats the starting position
+  EXPECT_TRUE(b.has_upcoming_repetition(4));
+  // unless the starting position is before the root
+  EXPECT_FALSE(b.has_upcoming_repetition(3));
+
+  // the path back has to be free
+  b = Board::get_starting_position();
+  b.make(Move(g1, f3));
+  b.make(Move(g8, f6));
+  b.make(Move(f3, g1));
+  b.make(Move(e7, e6));
+  EXPECT_FALSE(b.has_upcoming_repetition(10));
+
+  // only the player to move can move the piece back
+  b = fen::get_position("7k/8/8/8/8/8/8/4K3 b - - 0 1");
+  b.make(Move(h8, g8));
+  b.make(Move(e1, d1));
+  b.make(Move(g8, f8));
+  b.make(Move(d1, d2));
+  b.make(Move(f8, g8));
+  b.make(Move(d2, e1));
+  b.make(Move(g8, g7));
+  EXPECT_FALSE(b.has_upcoming_repetition(10));
+}
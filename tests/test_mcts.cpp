@@ -0,0 +1,71 @@
+#include "board/board.hpp"
+#include "engine/mcts.hpp"
+#include "fen.hpp"
+#include <gtest/gtest.h>
+
+TEST(MctsTests, ScoreToWdl) {
+  const Wdl equal = mcts::score_to_wdl(0);
+  EXPECT_EQ(equal.win, equal.loss);
+  EXPECT_GT(equal.draw, 0);
+
+  const Wdl better = mcts::score_to_wdl(200);
+  const Wdl worse = mcts::score_to_wdl(-200);
+  EXPECT_EQ(better.win, worse.loss);
+  EXPECT_GT(better.win, equal.win);
+  for (const Wdl &wdl : {equal, better, worse}) {
+    EXPECT_EQ(wdl.win + wdl.draw + wdl.loss, 1000);
+  }
+
+  EXPECT_EQ(mcts::score_to_wdl(CHECKMATE - 3).win, 1000);
+  EXPECT_EQ(mcts::score_to_wdl(-CHECKMATE + 2).loss, 1000);
+}
+
+TEST(MctsTests, FindsMateInOne) {
+  Board board = fen::get_position("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+  const History history = {};
+  std::atomic<bool> stop = false;
+  std::atomic<bool> ponder = false;
+  const SearchLimits limits = {
+      .depth = MAX_DEPTH,
+      .allocated_time = 60000,
+      .multi_pv = 1,
+      .search_moves = {},
+      .max_nodes = 200,
+      .flexible_time = false,
+  };
+
+  for (int nr_threads : {1, 2}) {
+    mcts::SearchMemory memory(nr_threads);
+    const std::vector<SearchSummary> search_summaries =
+        mcts::search(board, history, limits, memory, stop, ponder);
+    const SearchSummary &search_summary = search_summaries.back();
+    EXPECT_EQ(search_summary.pv.front(), Move(a1, a8));
+    EXPECT_EQ(search_summary.score, CHECKMATE - 1);
+  }
+}
+
+TEST(MctsTests, MemoryIsReused) {
+  Board board = Board::get_starting_position();
+  const Board starting_position = board;
+  const History history = {};
+  std::atomic<bool> stop = false;
+  std::atomic<bool> ponder = false;
+  const SearchLimits limits = {
+      .depth = MAX_DEPTH,
+      .allocated_time = 60000,
+      .multi_pv = 1,
+      .search_moves = {},
+      .max_nodes = 100,
+      .flexible_time = false,
+  };
+  mcts::SearchMemory memory(1);
+
+  // a search in a cleared pool is the same as in a new one
+  const std::vector<SearchSummary> first =
+      mcts::search(board, history, limits, memory, stop, ponder);
+  const std::vector<SearchSummary> second =
+      mcts::search(board, history, limits, memory, stop, ponder);
+  EXPECT_EQ(first.back().score, second.back().score);
+  EXPECT_EQ(first.back().pv, second.back().pv);
+  EXPECT_EQ(board, starting_position);
+}
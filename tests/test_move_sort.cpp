@@ -4,30 +4,96 @@
 #include "move.hpp"
 #include <gtest/gtest.h>
 #include <optional>
-#include <unordered_set>
 
 TEST(MoveSortTests, Position1) {
   Board board = fen::get_position(
       "r5k1/ppp3r1/3b2qp/PP1Ppp2/4n2B/1B1Q1P1P/6P1/2R1R1K1 w - - 1 29");
   std::vector<Move> moves = board.get_legal_moves();
   std::optional<Move> best_move_prev_depth = std::make_optional(Move(c1, c2));
-  std::unordered_set<Move, Move::HashFunction> killer_moves = {};
-  sort_moves(moves, best_move_prev_depth, killer_moves, board);
+  KillerMoves killer_moves = {};
+  History history = {};
+  sort_moves(moves, best_move_prev_depth, killer_moves, history, board);
 
   EXPECT_EQ(moves.at(0), Move(c1, c2));
   EXPECT_EQ(moves.at(1), Move(f3, e4));
-  EXPECT_EQ(moves.at(2), Move(e1, e4));
-  EXPECT_EQ(moves.at(3), Move(c1, c7));
-  EXPECT_EQ(moves.at(4), Move(d3, e4));
+
+  // captures that lose material come after the quiet moves
+  const size_t size = moves.size();
+  EXPECT_EQ(moves.at(size - 3), Move(e1, e4));
+  EXPECT_EQ(moves.at(size - 2), Move(c1, c7));
+  EXPECT_EQ(moves.at(size - 1), Move(d3, e4));
 }
 
 TEST(MoveSortTests, Position2) {
   Board board = fen::get_position(
       "r1bq1rk1/pp1nbpp1/4p2p/3pP3/1npP4/2P2N2/PPQ1NPPP/RBB2RK1 w - - 2 12");
   std::vector<Move> moves = board.get_legal_moves();
-  std::unordered_set<Move, Move::HashFunction> killer_moves = {Move(c2, h7)};
-  sort_moves(moves, std::nullopt, killer_moves, board);
+  KillerMoves killer_moves = {Move(c2, h7)};
+  History history = {};
+  sort_moves(moves, std::nullopt, killer_moves, history, board);
 
   EXPECT_EQ(moves.at(0), Move(c3, b4));
   EXPECT_EQ(moves.at(1), Move(c2, h7));
 }
+
+TEST(MoveSortTests, StoreKillerMove) {
+  KillerMoves killer_moves = {};
+  store_killer_move(killer_moves, Move(e2, e4));
+  store_killer_move(killer_moves, Move(d2, d4));
+  store_killer_move(killer_moves, Move(d2, d4));
+
+  EXPECT_EQ(killer_moves.at(0), Move(d2, d4));
+  EXPECT_EQ(killer_moves.at(1), Move(e2, e4));
+
+  store_killer_move(killer_moves, Move(g1, f3));
+  EXPECT_EQ(killer_moves.at(0), Move(g1, f3));
+  EXPECT_EQ(killer_moves.at(1), Move(d2, d4));
+}
+
+TEST(MoveSortTests, HistoryOrdersQuietMoves) {
+  Board board = Board::get_starting_position();
+  std::vector<Move> moves = board.get_legal_moves();
+  History history = {};
+  update_history(history, Move(b1, c3), board, history_bonus(4));
+  update_history(history, Move(g2, g3), board, history_bonus(1));
+  update_history(history, Move(a2, a3), board, -history_bonus(4));
+  sort_moves(moves, std::nullopt, KillerMoves{}, history, board);
+
+  EXPECT_EQ(moves.front(), Move(b1, c3));
+  EXPECT_EQ(moves.at(1), Move(g2, g3));
+  EXPECT_EQ(moves.back(), Move(a2, a3));
+}
+
+TEST(MoveSortTests, CountermoveBeforeOtherQuietMoves) {
+  Board board = Board::get_starting_position();
+  board.make(Move(e2, e4, PAWN_TWO_SQUARES_FORWARD));
+  History history = {};
+  store_countermove(history, Move(c7, c5, PAWN_TWO_SQUARES_FORWARD), board);
+  update_history(history, Move(g8, f6), board, history_bonus(4));
+
+  std::vector<Move> moves = board.get_legal_moves();
+  KillerMoves killer_moves = {Move(d7, d5, PAWN_TWO_SQUARES_FORWARD)};
+  sort_moves(moves, std::nullopt, killer_moves, history, board);
+
+  EXPECT_EQ(moves.at(0), Move(d7, d5));
+  EXPECT_EQ(moves.at(1), Move(c7, c5));
+  EXPECT_EQ(moves.at(2), Move(g8, f6));
+}
+
+TEST(MoveSortTests, PickMoveInScoreOrder) {
+  Board board = fen::get_position(
+      "r1bq1rk1/pp1nbpp1/4p2p/3pP3/1npP4/2P2N2/PPQ1NPPP/RBB2RK1 w - - 2 12");
+  KillerMoves killer_moves = {Move(c2, h7)};
+  History history = {};
+  ScoredMoves scored_moves = score_moves(board.get_legal_moves(), Move(f3, h4),
+                                         killer_moves, history, board);
+  ASSERT_EQ(scored_moves.moves.size(), scored_moves.scores.size());
+
+  EXPECT_EQ(pick_move(scored_moves, 0), Move(f3, h4));
+  EXPECT_EQ(pick_move(scored_moves, 1), Move(c3, b4));
+  EXPECT_EQ(pick_move(scored_moves, 2), Move(c2, h7));
+  for (int i = 3; i < scored_moves.moves.size(); i++) {
+    pick_move(scored_moves, i);
+    EXPECT_LE(scored_moves.scores.at(i), scored_moves.scores.at(i - 1));
+  }
+}
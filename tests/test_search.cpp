@@ -0,0 +1,90 @@
+#include "board/board.hpp"
+#include "engine/history.hpp"
+#include "engine/search.hpp"
+#include "engine/transposition_table.hpp"
+#include "fen.hpp"
+#include <gtest/gtest.h>
+
+TEST(SearchTests, AbortedSearchRestoresBoard) {
+  const std::vector<std::string> fens = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  };
+  // node limits that stop the searches at different points of the tree
+  const std::vector<long> node_limits = {1000, 5000, 20000, 50000};
+  for (const std::string &fen : fens) {
+    for (long max_nodes : node_limits) {
+      Board board = fen::get_position(fen);
+      const Board starting_position = fen::get_position(fen);
+      History history = {};
+      TranspositionTable tt(1);
+      std::atomic<bool> stop = false;
+      std::atomic<bool> ponder = false;
+      const SearchLimits limits = {
+          .depth = MAX_DEPTH,
+          .allocated_time = 60000,
+          .multi_pv = 1,
+          .search_moves = {},
+          .max_nodes = max_nodes,
+          .flexible_time = false,
+      };
+      search::iterative_deepening_search(board, history, tt, limits, stop,
+                                         ponder);
+      EXPECT_EQ(board, starting_position);
+      EXPECT_EQ(board.get_zobrist_key(), starting_position.get_zobrist_key());
+      EXPECT_EQ(board.get_player_to_move(),
+                starting_position.get_player_to_move());
+    }
+  }
+}
+
+TEST(SearchTests, FixedNodeSearchesRepeat) {
+  Board board = fen::get_position(
+      "r1bqkb1r/pp3ppp/2n1pn2/2pp4/3P4/2PBPN2/PP3PPP/RNBQK2R w KQkq - 0 6");
+  const Board starting_position = board;
+  History history = {};
+  TranspositionTable tt(1);
+  std::atomic<bool> stop = false;
+  std::atomic<bool> ponder = false;
+  const SearchLimits limits = {
+      .depth = MAX_DEPTH,
+      .allocated_time = 60000,
+      .multi_pv = 1,
+      .search_moves = {},
+      .max_nodes = 50000,
+      .flexible_time = false,
+  };
+
+  const std::vector<SearchSummary> first = search::iterative_deepening_search(
+      board, history, tt, limits, stop, ponder);
+  EXPECT_EQ(board, starting_position);
+  // what ucinewgame does between the searches
+  tt.clear();
+  history = {};
+  const std::vector<SearchSummary> second = search::iterative_deepening_search(
+      board, history, tt, limits, stop, ponder);
+  EXPECT_EQ(board, starting_position);
+
+  ASSERT_EQ(first.size(), second.size());
+  for (int i = 0; i < first.size(); i++) {
+    EXPECT_EQ(first.at(i).depth, second.at(i).depth);
+    EXPECT_EQ(first.at(i).score, second.at(i).score);
+    EXPECT_EQ(first.at(i).nodes, second.at(i).nodes);
+    EXPECT_EQ(first.at(i).pv, second.at(i).pv);
+  }
+}
+
+TEST(SearchTests, PerpetualCheckIsDraw) {
+  // Black is a queen and two rooks against a queen up, but White can check
+  // forever with Qe8+ Kh7 Qh5+ Kg8. The repetition is a draw as soon as the
+  // search can repeat a position from after the root, so the upcoming
+  // repetition that raises alpha to DRAW agrees with the searched lines.
+  const std::string fen = "6k1/q5p1/8/7Q/8/8/rr3PPP/6K1 w - - 0 1";
+  for (int depth = 2; depth <= 6; depth++) {
+    Board board = fen::get_position(fen);
+    History history = {};
+    TranspositionTable tt(1);
+    EXPECT_EQ(search::shallow_search(board, depth, history, tt), DRAW)
+        << "depth " << depth;
+  }
+}
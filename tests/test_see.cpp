@@ -0,0 +1,41 @@
+#include "board/board.hpp"
+#include "fen.hpp"
+#include "move.hpp"
+#include <gtest/gtest.h>
+
+TEST(SeeTests, UndefendedPawn) {
+  Board b =
+      fen::get_position("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+  EXPECT_TRUE(b.see(Move(e1, e5), 0));
+  EXPECT_TRUE(b.see(Move(e1, e5), 100));
+  EXPECT_FALSE(b.see(Move(e1, e5), 101));
+}
+
+TEST(SeeTests, DefendedPawn) {
+  Board b = fen::get_position(
+      "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+  EXPECT_FALSE(b.see(Move(d3, e5), 0));
+  EXPECT_TRUE(b.see(Move(d3, e5), -200));
+  EXPECT_FALSE(b.see(Move(d3, e5), -199));
+}
+
+TEST(SeeTests, XRay) {
+  Board b = fen::get_position("4k3/8/2p5/3p4/8/8/3R4/3Q2K1 w - - 0 1");
+  EXPECT_FALSE(b.see(Move(d2, d5), 0));
+  EXPECT_TRUE(b.see(Move(d2, d5), -300));
+  EXPECT_FALSE(b.see(Move(d2, d5), -299));
+}
+
+TEST(SeeTests, KingCanOnlyCaptureUndefendedPieces) {
+  Board b = fen::get_position("8/8/4k3/3p4/8/8/3R4/3K4 w - - 0 1");
+  EXPECT_FALSE(b.see(Move(d2, d5), 0));
+
+  b = fen::get_position("8/8/4k3/3p4/8/8/3R4/3QK3 w - - 0 1");
+  EXPECT_TRUE(b.see(Move(d2, d5), 100));
+}
+
+TEST(SeeTests, QuietMove) {
+  Board b = fen::get_position("4k3/8/2p5/8/8/8/3R4/3QK3 w - - 0 1");
+  EXPECT_TRUE(b.see(Move(d2, d4), 0));
+  EXPECT_FALSE(b.see(Move(d2, d5), 0));
+}
@@ -0,0 +1,66 @@
+#include "engine/search.hpp"
+#include "engine/transposition_table.hpp"
+#include "move.hpp"
+#include <gtest/gtest.h>
+
+TEST(TranspositionTableTests, StoreAndProbe) {
+  TranspositionTable tt(1);
+  EXPECT_FALSE(tt.probe(12345).has_value());
+
+  tt.store({.key = 12345,
+            .depth = 4,
+            .score = 30,
+            .bound = EXACT,
+            .best_move = Move(e2, e4)});
+  std::optional<TTEntry> entry = tt.probe(12345);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry.value().depth, 4);
+  EXPECT_EQ(entry.value().score, 30);
+  EXPECT_EQ(entry.value().best_move, Move(e2, e4));
+
+  // an entry without a best move keeps the best move of the position
+  tt.store({.key = 12345,
+            .depth = 5,
+            .score = -10,
+            .bound = UPPER_BOUND,
+            .best_move = std::nullopt});
+  entry = tt.probe(12345);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry.value().depth, 5);
+  EXPECT_EQ(entry.value().bound, UPPER_BOUND);
+  EXPECT_EQ(entry.value().best_move, Move(e2, e4));
+
+  tt.clear();
+  EXPECT_FALSE(tt.probe(12345).has_value());
+}
+
+TEST(TranspositionTableTests, MateScores) {
+  const int mate_in_3 = CHECKMATE - 5;
+  EXPECT_EQ(score_to_tt(mate_in_3, 2), CHECKMATE - 3);
+  EXPECT_EQ(score_from_tt(score_to_tt(mate_in_3, 2), 4), CHECKMATE - 7);
+  EXPECT_EQ(score_from_tt(score_to_tt(-mate_in_3, 2), 2), -mate_in_3);
+  EXPECT_EQ(score_to_tt(150, 7), 150);
+}
+
+TEST(TranspositionTableTests, Replacement) {
+  TranspositionTable tt(1);
+  tt.store({.key = 777,
+            .depth = 6,
+            .score = 10,
+            .bound = LOWER_BOUND,
+            .best_move = Move(d2, d4),
+            .static_eval = 42});
+
+  // a shallower result doesn't replace the deeper one of the same search
+  tt.store({.key = 777, .depth = 0, .score = -5, .bound = UPPER_BOUND});
+  EXPECT_EQ(tt.probe(777).value().depth, 6);
+
+  // but it does replace the results of earlier searches
+  tt.new_search();
+  tt.store({.key = 777, .depth = 0, .score = -5, .bound = UPPER_BOUND});
+  std::optional<TTEntry> entry = tt.probe(777);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry.value().depth, 0);
+  EXPECT_EQ(entry.value().best_move, Move(d2, d4));
+  EXPECT_EQ(entry.value().static_eval, 42);
+}
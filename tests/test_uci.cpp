@@ -0,0 +1,25 @@
+#include "engine/command.hpp"
+#include "uci.hpp"
+#include <gtest/gtest.h>
+
+TEST(UciTests, GoNodes) {
+  const Command command = uci::process("go nodes 50000");
+  EXPECT_EQ(command.type, CommandType::GoNodes);
+  EXPECT_EQ(command.arg.nodes, 50000);
+}
+
+TEST(UciTests, GoNodesLargerThanInt) {
+  const Command command = uci::process("go nodes 3000000000");
+  EXPECT_EQ(command.type, CommandType::GoNodes);
+  EXPECT_EQ(command.arg.nodes, 3000000000L);
+}
+
+TEST(UciTests, GoNodesInvalid) {
+  for (const std::string input :
+       {"go nodes 99999999999999999999", "go nodes 0", "go nodes -5",
+        "go nodes many"}) {
+    const Command command = uci::process(input);
+    EXPECT_EQ(command.type, CommandType::Invalid) << input;
+    free(command.arg.str);
+  }
+}
@@ -4,8 +4,13 @@
 #include "test_draw.cpp"
 #include "test_move.cpp"
 #include "test_basic_move_gen.cpp"
+#include "test_mcts.cpp"
 #include "test_move_sort.cpp"
 #include "test_move_gen.cpp"
+#include "test_search.cpp"
+#include "test_see.cpp"
+#include "test_transposition_table.cpp"
+#include "test_uci.cpp"
 
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);